@@ -0,0 +1,152 @@
+// Microbenchmark: SIMD mat4 kernels vs the scalar loops they replaced in cube.cpp.
+//   make bench && ./bench_mat4 [iterations]
+#include "mat4.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// the original cube.cpp multMatrix, kept verbatim as the baseline
+static void multMatrix(float* a, const float* b) {
+    float r[16];
+    for (int i=0;i<4;i++)
+        for (int j=0;j<4;j++) {
+            r[i*4+j]=0;
+            for (int k=0;k<4;k++)
+                r[i*4+j]+=a[i*4+k]*b[k*4+j];
+        }
+    std::memcpy(a,r,16*sizeof(float));
+}
+
+static void transposeScalar(float* r, const float* a) {
+    float t[16];
+    for (int i=0;i<4;i++) for (int j=0;j<4;j++) t[j*4+i]=a[i*4+j];
+    std::memcpy(r,t,sizeof t);
+}
+
+// Gauss-Jordan with partial pivoting, the usual hand-written fallback
+static bool inverseScalar(float* r, const float* m) {
+    float a[16], b[16];
+    std::memcpy(a,m,sizeof a);
+    for (int i=0;i<16;i++) b[i]=(i%5==0)?1.0f:0.0f;
+    for (int c=0;c<4;c++) {
+        int p=c;
+        for (int i=c+1;i<4;i++) if (std::fabs(a[i*4+c])>std::fabs(a[p*4+c])) p=i;
+        if (a[p*4+c]==0.0f) return false;
+        if (p!=c) for (int j=0;j<4;j++) { std::swap(a[c*4+j],a[p*4+j]); std::swap(b[c*4+j],b[p*4+j]); }
+        float d=1.0f/a[c*4+c];
+        for (int j=0;j<4;j++) { a[c*4+j]*=d; b[c*4+j]*=d; }
+        for (int i=0;i<4;i++) if (i!=c) {
+            float f=a[i*4+c];
+            for (int j=0;j<4;j++) { a[i*4+j]-=f*a[c*4+j]; b[i*4+j]-=f*b[c*4+j]; }
+        }
+    }
+    std::memcpy(r,b,sizeof b);
+    return true;
+}
+
+static void transformScalar(float* out, const float* in, size_t n, const float* m) {
+    for (size_t v=0; v<n; v++)
+        for (int j=0;j<4;j++)
+            out[v*4+j]=in[v*4]*m[j]+in[v*4+1]*m[4+j]+in[v*4+2]*m[8+j]+in[v*4+3]*m[12+j];
+}
+
+template <class F>
+static double nsPerOp(long iters, F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i=0; i<iters; i++) f(i);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1-t0).count() / iters;
+}
+
+static void report(const char* name, double scalar, double simd) {
+    std::printf("%-22s scalar %7.2f ns   simd %7.2f ns   speedup %5.2fx\n", name, scalar, simd, scalar/simd);
+}
+
+static void makeTRS(float* m, float s, float ax, float ay, float tx, float ty, float tz) {
+    float cx=std::cos(ax), sx=std::sin(ax), cy=std::cos(ay), sy=std::sin(ay);
+    float S[16]={s,0,0,0, 0,s,0,0, 0,0,s,0, 0,0,0,1};
+    float Rx[16]={1,0,0,0, 0,cx,sx,0, 0,-sx,cx,0, 0,0,0,1};
+    float Ry[16]={cy,0,-sy,0, 0,1,0,0, sy,0,cy,0, 0,0,0,1};
+    float T[16]={1,0,0,0, 0,1,0,0, 0,0,1,0, tx,ty,tz,1};
+    mat4Identity(m); mat4Mul(m,m,S); mat4Mul(m,m,Rx); mat4Mul(m,m,Ry); mat4Mul(m,m,T);
+}
+
+int main(int argc, char** argv) {
+    long iters = argc > 1 ? std::atol(argv[1]) : 20000000;
+    const char* isa =
+#if defined(SIMD_NEON)
+        "NEON";
+#elif defined(SIMD_SSE) && defined(__AVX__)
+        "SSE+AVX";
+#elif defined(SIMD_SSE)
+        "SSE";
+#else
+        "scalar";
+#endif
+    std::printf("mat4 kernels (%s), %ld iterations\n", isa, iters);
+
+    // a small pool of well-conditioned inputs so nothing folds to a constant
+    const int POOL = 64;
+    static float mats[POOL][16];
+    for (int i=0; i<POOL; i++) makeTRS(mats[i], 0.5f+0.01f*i, 0.1f*i, 0.07f*i, 0.1f*i, -0.2f, -3.0f);
+
+    // correctness against the scalar reference before timing anything
+    float maxErr = 0.0f;
+    for (int i=0; i<POOL; i++) {
+        float a[16], b[16], r[16];
+        std::memcpy(a, mats[i], sizeof a);
+        multMatrix(a, mats[(i+1)%POOL]);
+        mat4Mul(b, mats[i], mats[(i+1)%POOL]);
+        for (int k=0;k<16;k++) maxErr = std::fmax(maxErr, std::fabs(a[k]-b[k]));
+        inverseScalar(a, mats[i]); mat4Inverse(r, mats[i]);
+        for (int k=0;k<16;k++) maxErr = std::fmax(maxErr, std::fabs(a[k]-r[k]));
+        transposeScalar(a, mats[i]); mat4Transpose(r, mats[i]);
+        for (int k=0;k<16;k++) maxErr = std::fmax(maxErr, std::fabs(a[k]-r[k]));
+    }
+    std::printf("max abs error vs scalar: %g\n", maxErr);
+    if (maxErr > 1e-4f) { std::fprintf(stderr, "kernel mismatch\n"); return 1; }
+
+    float acc[16]; mat4Identity(acc);
+    volatile float sink = 0.0f;
+
+    double s = nsPerOp(iters, [&](long i){ multMatrix(acc, mats[i & (POOL-1)]); acc[15]=1.0f; });
+    sink = sink + acc[0];
+    double v = nsPerOp(iters, [&](long i){ mat4Mul(acc, acc, mats[i & (POOL-1)]); acc[15]=1.0f; });
+    sink = sink + acc[0];
+    report("multiply", s, v);
+
+    // the per-frame makeTransform chain: identity then four multiplies
+    s = nsPerOp(iters/4, [&](long i){
+        float m[16]; mat4Identity(m);
+        for (int k=0;k<4;k++) multMatrix(m, mats[(i+k) & (POOL-1)]);
+        sink = sink + m[5];
+    });
+    v = nsPerOp(iters/4, [&](long i){
+        float m[16]; mat4Identity(m);
+        for (int k=0;k<4;k++) mat4Mul(m, m, mats[(i+k) & (POOL-1)]);
+        sink = sink + m[5];
+    });
+    report("makeTransform chain", s, v);
+
+    s = nsPerOp(iters, [&](long i){ transposeScalar(acc, mats[i & (POOL-1)]); sink = sink + acc[1]; });
+    v = nsPerOp(iters, [&](long i){ mat4Transpose(acc, mats[i & (POOL-1)]); sink = sink + acc[1]; });
+    report("transpose", s, v);
+
+    s = nsPerOp(iters/4, [&](long i){ inverseScalar(acc, mats[i & (POOL-1)]); sink = sink + acc[2]; });
+    v = nsPerOp(iters/4, [&](long i){ mat4Inverse(acc, mats[i & (POOL-1)]); sink = sink + acc[2]; });
+    report("inverse", s, v);
+
+    // batches of homogeneous points
+    const size_t N = 4096;
+    static float in[N*4], out[N*4];
+    for (size_t i=0; i<N*4; i++) in[i] = (i%4==3) ? 1.0f : float(i%7)*0.1f - 0.3f;
+    long passes = iters / long(N) + 1;
+    s = nsPerOp(passes, [&](long i){ transformScalar(out, in, N, mats[i & (POOL-1)]); sink = sink + out[i & 1023]; }) / N;
+    v = nsPerOp(passes, [&](long i){ mat4TransformVec4Array(out, in, N, mats[i & (POOL-1)]); sink = sink + out[i & 1023]; }) / N;
+    report("transform vec4", s, v);
+
+    return sink == 12345.0f;
+}
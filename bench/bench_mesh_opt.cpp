@@ -0,0 +1,118 @@
+// Benchmark: mesh_opt.h on large tessellated meshes in the builders' format
+// (x, y, r, g, b triangle lists, no indices). Reports welding, ACMR/ATVR on a
+// 16-entry FIFO before and after the cache and fetch reorderings, and how long
+// each step takes.
+//   make bench && ./bench_mesh_opt [grid side] [disc rings]
+#include "mesh_opt.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+const int STRIDE = 5;
+
+static void addVertex(std::vector<float>& out, float x, float y) {
+    out.insert(out.end(), { x, y, 0.5f + 0.5f * x, 0.5f + 0.5f * y, 1.0f });
+}
+
+// side x side quads, two triangles each, row by row
+static std::vector<float> buildGrid(int side) {
+    std::vector<float> out;
+    float cell = 2.0f / side;
+    for (int y=0; y<side; y++)
+        for (int x=0; x<side; x++) {
+            float x0 = -1 + x * cell, y0 = -1 + y * cell, x1 = x0 + cell, y1 = y0 + cell;
+            addVertex(out, x0, y0); addVertex(out, x1, y0); addVertex(out, x1, y1);
+            addVertex(out, x0, y0); addVertex(out, x1, y1); addVertex(out, x0, y1);
+        }
+    return out;
+}
+
+// concentric rings around a centre fan, 64 segments per ring, outward
+static std::vector<float> buildDisc(int rings) {
+    const int SEG = 64;
+    const float PI = 3.14159265358979323846f;
+    std::vector<float> out;
+    auto ring = [&](int r, int s, float* xy) {
+        float t = 2.0f * PI * (s % SEG) / SEG, radius = float(r) / rings;
+        xy[0] = radius * std::cos(t); xy[1] = radius * std::sin(t);
+    };
+    for (int r=0; r<rings; r++)
+        for (int s=0; s<SEG; s++) {
+            float a[2], b[2], c[2], d[2];
+            ring(r, s, a); ring(r, s + 1, b); ring(r + 1, s, c); ring(r + 1, s + 1, d);
+            if (r == 0) { addVertex(out, 0, 0); addVertex(out, c[0], c[1]); addVertex(out, d[0], d[1]); continue; }
+            addVertex(out, a[0], a[1]); addVertex(out, c[0], c[1]); addVertex(out, d[0], d[1]);
+            addVertex(out, a[0], a[1]); addVertex(out, d[0], d[1]); addVertex(out, b[0], b[1]);
+        }
+    return out;
+}
+
+// the same triangles in random order, as a builder with no locality would emit them
+static std::vector<float> shuffleTriangles(const std::vector<float>& in) {
+    std::vector<std::array<float, STRIDE * 3>> tris(in.size() / (STRIDE * 3));
+    for (std::size_t t=0; t<tris.size(); t++) std::copy_n(&in[t * STRIDE * 3], STRIDE * 3, tris[t].begin());
+    std::shuffle(tris.begin(), tris.end(), std::mt19937(1));
+    std::vector<float> out;
+    for (const auto& t : tris) out.insert(out.end(), t.begin(), t.end());
+    return out;
+}
+
+// each triangle's positions, rotated to start at its smallest vertex (keeps
+// the winding), sorted: equal lists mean the same triangles were drawn
+static std::vector<std::array<float, 6>> triangleSet(const std::vector<float>& v, const std::vector<std::uint32_t>& idx) {
+    std::vector<std::array<float, 6>> set;
+    for (std::size_t t=0; t<idx.size(); t+=3) {
+        std::array<float, 6> p;
+        for (int k=0; k<3; k++) { p[k*2] = v[idx[t+k] * STRIDE]; p[k*2+1] = v[idx[t+k] * STRIDE + 1]; }
+        int m = 0;
+        for (int k=1; k<3; k++) if (std::make_pair(p[k*2], p[k*2+1]) < std::make_pair(p[m*2], p[m*2+1])) m = k;
+        std::rotate(p.begin(), p.begin() + m * 2, p.end());
+        set.push_back(p);
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static bool run(const char* name, std::vector<float> vertices) {
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::size_t inputVerts = vertices.size() / STRIDE;
+
+    Clock::time_point t0 = Clock::now();
+    std::vector<std::uint32_t> indices = weldVertices(vertices, STRIDE);
+    Clock::time_point t1 = Clock::now();
+    std::vector<std::array<float, 6>> before = triangleSet(vertices, indices);
+    MeshCacheStats naive = meshCacheStats(indices, vertices.size() / STRIDE);
+    Clock::time_point t2 = Clock::now();
+    optimizeVertexCache(indices, vertices.size() / STRIDE);
+    Clock::time_point t3 = Clock::now();
+    MeshCacheStats cached = meshCacheStats(indices, vertices.size() / STRIDE);
+    optimizeVertexFetch(vertices, STRIDE, indices);
+    Clock::time_point t4 = Clock::now();
+    MeshCacheStats fetched = meshCacheStats(indices, vertices.size() / STRIDE);
+
+    std::printf("%s: %zu triangles, %zu vertices welded to %zu (%.1f ms)\n", name, indices.size() / 3,
+                inputVerts, vertices.size() / STRIDE, ms(t0, t1));
+    std::printf("  as emitted:       ACMR %.3f  ATVR %.3f\n", naive.acmr, naive.atvr);
+    std::printf("  vertex cache:     ACMR %.3f  ATVR %.3f  (%.1f ms)\n", cached.acmr, cached.atvr, ms(t2, t3));
+    std::printf("  + vertex fetch:   ACMR %.3f  ATVR %.3f  (%.1f ms)\n", fetched.acmr, fetched.atvr, ms(t3, t4));
+    if (triangleSet(vertices, indices) != before) {
+        std::fprintf(stderr, "%s: triangles changed\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? std::atoi(argv[1]) : 512;
+    int rings = argc > 2 ? std::atoi(argv[2]) : 2048;
+    std::vector<float> grid = buildGrid(side), disc = buildDisc(rings);
+    bool ok = run("grid, row order", grid) && run("grid, shuffled", shuffleTriangles(grid)) &&
+              run("disc, ring order", disc) && run("disc, shuffled", shuffleTriangles(disc));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// Benchmark: N model matrices per frame from SoA parameters, batched SIMD path
+// vs calling composeTRS once per object.
+//   make bench && ./bench_transform_batch [objects] [frames]
+#include "transform.h"
+#include "transform_batch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int frames = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    TransformBatch batch;
+    batch.resize(n);
+    for (std::size_t i=0; i<n; i++) {
+        batch.scale[i]  = 0.5f + 0.001f * float(i % 500);
+        batch.rotX[i]   = 0.013f * float(i % 977) - 6.0f;
+        batch.rotY[i]   = 0.021f * float(i % 613) + 3.0f;
+        batch.transX[i] = float(i % 100) * 0.1f;
+        batch.transY[i] = float((i / 100) % 100) * 0.1f;
+        batch.transZ[i] = -3.0f - float(i / 10000);
+    }
+    std::vector<float> out(n * 16), ref(n * 16);
+
+    for (std::size_t i=0; i<n; i++)
+        composeTRS(&ref[i*16], batch.scale[i], batch.rotX[i], batch.rotY[i],
+                   batch.transX[i], batch.transY[i], batch.transZ[i]);
+    batch.compose(out.data());
+    float maxErr = 0.0f;
+    for (std::size_t i=0; i<n*16; i++) maxErr = std::max(maxErr, std::fabs(out[i] - ref[i]));
+    std::printf("%zu objects, max abs error vs composeTRS: %g\n", n, maxErr);
+    if (maxErr > 1e-4f) { std::fprintf(stderr, "batch mismatch\n"); return 1; }
+
+    auto time = [&](auto&& body) {
+        double best = 1e30;
+        for (int f=0; f<frames; f++) {
+            auto t0 = std::chrono::steady_clock::now();
+            body(f);
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1-t0).count());
+        }
+        return best;
+    };
+
+    double scalar = time([&](int f) {
+        float wobble = 0.001f * f;
+        for (std::size_t i=0; i<n; i++)
+            composeTRS(&ref[i*16], batch.scale[i], batch.rotX[i] + wobble, batch.rotY[i],
+                       batch.transX[i], batch.transY[i], batch.transZ[i]);
+    });
+    double simd = time([&](int f) {
+        batch.rotX[f % n] += 0.001f;
+        batch.compose(out.data());
+    });
+
+    std::printf("per-object composeTRS: %7.2f ms/frame  %6.2f ns/transform\n", scalar*1e-6, scalar/n);
+    std::printf("TransformBatch:        %7.2f ms/frame  %6.2f ns/transform  (%.2fx)\n",
+                simd*1e-6, simd/n, scalar/simd);
+    volatile float sink = out[n*8] + ref[n*8];
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Benchmark: the S * Rx * Ry * T chain as vecmath.h expression templates vs
+// the original multMatrix chain, the SIMD mat4Mul chain and composeTRS.
+//   make bench && ./bench_vecmath [iterations]
+// The chains are noinline so their code can be compared directly:
+//   objdump -d --no-show-raw-insn -C bench_vecmath | less   (search for "Chain")
+#include "mat4.h"
+#include "transform.h"
+#include "vecmath.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Params { float s, rx, ry, tx, ty, tz; };
+
+// the original cube.cpp multMatrix
+static void multMatrix(float* a, const float* b) {
+    float r[16];
+    for (int i=0;i<4;i++)
+        for (int j=0;j<4;j++) {
+            r[i*4+j]=0;
+            for (int k=0;k<4;k++)
+                r[i*4+j]+=a[i*4+k]*b[k*4+j];
+        }
+    std::memcpy(a,r,16*sizeof(float));
+}
+
+// the original makeTransform body
+__attribute__((noinline)) static void multMatrixChain(float* m, const Params& p) {
+    std::memset(m, 0, 16*sizeof(float));
+    m[0]=m[5]=m[10]=m[15]=1.0f;
+    float S[16]={p.s,0,0,0, 0,p.s,0,0, 0,0,p.s,0, 0,0,0,1};
+    multMatrix(m,S);
+    float cx=std::cos(p.rx), sx=std::sin(p.rx);
+    float Rx[16]={1,0,0,0, 0,cx,sx,0, 0,-sx,cx,0, 0,0,0,1};
+    multMatrix(m,Rx);
+    float cy=std::cos(p.ry), sy=std::sin(p.ry);
+    float Ry[16]={cy,0,-sy,0, 0,1,0,0, sy,0,cy,0, 0,0,0,1};
+    multMatrix(m,Ry);
+    float T[16]={1,0,0,0, 0,1,0,0, 0,0,1,0, p.tx,p.ty,p.tz,1};
+    multMatrix(m,T);
+}
+
+__attribute__((noinline)) static void mat4MulChain(float* m, const Params& p) {
+    float cx=std::cos(p.rx), sx=std::sin(p.rx), cy=std::cos(p.ry), sy=std::sin(p.ry);
+    float S[16]={p.s,0,0,0, 0,p.s,0,0, 0,0,p.s,0, 0,0,0,1};
+    float Rx[16]={1,0,0,0, 0,cx,sx,0, 0,-sx,cx,0, 0,0,0,1};
+    float Ry[16]={cy,0,-sy,0, 0,1,0,0, sy,0,cy,0, 0,0,0,1};
+    float T[16]={1,0,0,0, 0,1,0,0, 0,0,1,0, p.tx,p.ty,p.tz,1};
+    mat4Mul(m,S,Rx); mat4Mul(m,m,Ry); mat4Mul(m,m,T);
+}
+
+__attribute__((noinline)) static void expressionChain(float* m, const Params& p) {
+    storeMatrix(m, Scale(p.s) * RotX(SinCos{std::sin(p.rx), std::cos(p.rx)})
+                              * RotY(SinCos{std::sin(p.ry), std::cos(p.ry)}) * Translate(p.tx, p.ty, p.tz));
+}
+
+__attribute__((noinline)) static void closedFormChain(float* m, const Params& p) {
+    composeTRS(m, p.s, p.rx, p.ry, p.tx, p.ty, p.tz);
+}
+
+template <class F>
+static double nsPerCall(long iters, const Params* ps, F f, float& sink) {
+    float m[16];
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i=0; i<iters; i++) { f(m, ps[i & 255]); sink += m[6]; }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1-t0).count() / iters;
+}
+
+int main(int argc, char** argv) {
+    long iters = argc > 1 ? std::atol(argv[1]) : 10000000;
+    static Params ps[256];
+    for (int i=0; i<256; i++) ps[i] = { 0.5f+0.01f*i, 0.05f*i, -0.03f*i, 0.01f*i, -0.2f, -3.0f };
+
+    float a[16], b[16], maxErr = 0.0f;
+    for (int i=0; i<256; i++) {
+        multMatrixChain(a, ps[i]); expressionChain(b, ps[i]);
+        for (int k=0;k<16;k++) maxErr = std::fmax(maxErr, std::fabs(a[k]-b[k]));
+    }
+    std::printf("max abs error vs multMatrix chain: %g\n", maxErr);
+    if (maxErr > 1e-5f) { std::fprintf(stderr, "expression chain mismatch\n"); return 1; }
+
+    float sink = 0.0f;
+    double base = nsPerCall(iters, ps, multMatrixChain, sink);
+    double simd = nsPerCall(iters, ps, mat4MulChain, sink);
+    double et   = nsPerCall(iters, ps, expressionChain, sink);
+    double cf   = nsPerCall(iters, ps, closedFormChain, sink);
+    std::printf("multMatrix chain      %7.2f ns\n", base);
+    std::printf("mat4Mul chain         %7.2f ns  (%.2fx)\n", simd, base/simd);
+    std::printf("expression templates  %7.2f ns  (%.2fx)\n", et, base/et);
+    std::printf("composeTRS            %7.2f ns  (%.2fx)\n", cf, base/cf);
+
+    // constant chains fold completely at compile time
+    constexpr Mat4 folded = Scale(2.0f) * RotX(0.5f) * RotY(0.25f) * Translate(0.0f, 0.0f, -3.0f);
+    static_assert(folded(0,1) == 0.0f && folded(3,2) == -3.0f, "constant chain did not fold");
+    return sink == 12345.0f;
+}
@@ -0,0 +1,17 @@
+#version 130
+#ifndef PROCEDURAL
+// with PROCEDURAL, cubeVertex() comes from cube_procedural.glsl instead
+in vec3 vPos;
+in vec3 vColor;
+#endif
+out vec3 ourColor;
+uniform mat4 transform;
+uniform mat4 projection;
+void main() {
+#ifdef PROCEDURAL
+    vec3 vPos, vColor;
+    cubeVertex(vPos, vColor);
+#endif
+    gl_Position = projection * transform * vec4(vPos, 1.0);
+    ourColor = vColor;
+}
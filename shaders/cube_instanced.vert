@@ -0,0 +1,20 @@
+#version 130
+// --instances: one draw call, model matrix and tint from per-instance attributes
+#ifndef PROCEDURAL
+// with PROCEDURAL, cubeVertex() comes from cube_procedural.glsl instead
+in vec3 vPos;
+in vec3 vColor;
+#endif
+in mat4 iModel;
+in vec3 iColor;
+out vec3 ourColor;
+uniform mat4 transform;
+uniform mat4 projection;
+void main() {
+#ifdef PROCEDURAL
+    vec3 vPos, vColor;
+    cubeVertex(vPos, vColor);
+#endif
+    gl_Position = projection * transform * iModel * vec4(vPos, 1.0);
+    ourColor = vColor * iColor;
+}
@@ -0,0 +1,12 @@
+// --procedural: put in front of the cube vertex shaders, after their #version
+// and #defines. There is no vertex buffer; vertex gl_VertexID of 36 picks a
+// corner of the unit cube through the index list, and the corner number
+// spells out its position and color.
+const int CUBE_INDEX[36] = int[36](0,1,2,2,3,0, 1,5,6,6,2,1, 5,4,7,7,6,5, 4,0,3,3,7,4, 3,2,6,6,7,3, 4,5,1,1,0,4);
+const vec3 CUBE_COLOR[8] = vec3[8](vec3(1,0,0), vec3(0,1,0), vec3(0,0,1), vec3(1,1,0),
+                                   vec3(1,0,1), vec3(0,1,1), vec3(1,1,1), vec3(0,0,0));
+void cubeVertex(out vec3 pos, out vec3 color) {
+    int c = CUBE_INDEX[gl_VertexID];
+    pos = vec3(((c + 1) & 2) != 0 ? 0.5 : -0.5, (c & 2) != 0 ? 0.5 : -0.5, (c & 4) != 0 ? 0.5 : -0.5);
+    color = CUBE_COLOR[c];
+}
@@ -0,0 +1,2 @@
+#version 130
+// the body is shapes_fragment.glsl, shared with shapes_ubo.frag
@@ -0,0 +1,22 @@
+// The fragment shader of both paths: appended to shapes.frag or
+// shapes_ubo.frag, which hold only their #version.
+in vec3 vColor;
+#ifdef SDF
+in vec2 vLocal;
+#endif
+out vec4 FragColor;
+void main() {
+#ifdef SDF
+    // signed distance to the rim in pixels, to first order: the implicit
+    // function over the length of its screen-space gradient. Coverage ramps
+    // over one pixel across the rim and is blended over the background. The
+    // gradient vanishes at the centre of a circle; the floor keeps d finite.
+    float f = length(vLocal) - 1.0;
+    float d = f / max(length(vec2(dFdx(f), dFdy(f))), 1e-6);
+    float coverage = clamp(0.5 - d, 0.0, 1.0);
+    if (coverage == 0.0) discard;
+    FragColor = vec4(vColor, coverage);
+#else
+    FragColor = vec4(vColor, 1.0);
+#endif
+}
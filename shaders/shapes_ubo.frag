@@ -0,0 +1,2 @@
+#version 140
+// the body is shapes_fragment.glsl, shared with shapes.frag
@@ -0,0 +1,74 @@
+#version 140
+// GL 3.2+: the same parameters as shapes.vert, read from a range of one
+// shared uniform buffer
+#ifdef INSTANCED
+// --circle-bench: many copies in one draw, each the mesh scaled by
+// iTransform.z and moved to iTransform.xy inside the draw's own transform
+in vec3 iTransform;
+in vec3 iColor;
+#endif
+out vec3 vColor;
+layout(std140) uniform DrawParams {
+    vec2 offset;
+    vec2 rotation;
+    vec3 overrideColor;
+    float scale;
+};
+#if defined(PROCEDURAL) || defined(SDF)
+uniform vec3 shape;
+uniform vec3 shapeColor;
+#endif
+#ifdef PROCEDURAL
+// --procedural: no vertex buffer, the vertex comes from gl_VertexID. A fan has
+// its centre first, then shape.z rim vertices around an ellipse with radii
+// shape.xy, closed on the first rim vertex; shape.z == 0 is the triangle.
+const vec2 TRIANGLE[3] = vec2[3](vec2(0.0, 0.2), vec2(-0.2, -0.2), vec2(0.2, -0.2));
+vec2 shapeVertex() {
+    if (shape.z == 0.0) return TRIANGLE[gl_VertexID];
+    if (gl_VertexID == 0) return vec2(0.0);
+    float t = 6.28318531 * float((gl_VertexID - 1) % int(shape.z)) / shape.z;
+    return shape.xy * vec2(cos(t), sin(t));
+}
+#elif defined(SDF)
+// --sdf: the ellipse with radii shape.xy is one quad around it, drawn as a
+// four-vertex fan from gl_VertexID; the fragment shader finds the rim. The
+// quad reaches one pixel past the rim on every side, room for the fringe.
+uniform float pixel;   // one pixel in clip units
+out vec2 vLocal;   // position in units of the radii, the rim is at length 1
+vec2 shapeVertex() {
+#ifdef INSTANCED
+    vec2 radii = shape.xy + pixel / (scale * iTransform.z);
+#else
+    vec2 radii = shape.xy + pixel / scale;
+#endif
+    vec2 corner = vec2(((gl_VertexID + 1) & 2) != 0 ? 1.0 : -1.0, (gl_VertexID & 2) != 0 ? 1.0 : -1.0);
+    vLocal = corner * radii / shape.xy;
+    return corner * radii;
+}
+#else
+in vec2 aPos;
+in vec3 aColor;
+#endif
+
+void main() {
+#if defined(PROCEDURAL) || defined(SDF)
+    vec2 aPos = shapeVertex();
+    vec3 aColor = shapeColor;
+#endif
+#ifdef INSTANCED
+    vec2 p = (aPos * iTransform.z + iTransform.xy) * scale;
+#else
+    vec2 p = aPos * scale;
+#endif
+#ifdef ROTATION
+    p = mat2(rotation.x, -rotation.y, rotation.y, rotation.x) * p;
+#endif
+    gl_Position = vec4(p + offset, 0.0, 1.0);
+#ifdef OVERRIDE_COLOR
+    vColor = overrideColor;
+#elif defined(INSTANCED)
+    vColor = iColor;
+#else
+    vColor = aColor;
+#endif
+}
@@ -3,93 +3,113 @@
 #include <iostream>
 #include <cmath>
 #include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "transform.h"
+#include "transform_batch.h"
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include "shader_program.h"
+#include "shader_reloader.h"
+#include "vecmath.h"
+#include "mesh_opt.h"
+#include "overdraw_meter.h"
 
 enum Mode { SCALE, ROTATE, TRANSLATE };
 Mode currentMode = ROTATE;
 
-// transformation parameters
-float scaleVal = 1.0f;
-float rotX = 0.0f, rotY = 0.0f;
-float transX = 0.0f, transY = 0.0f, transZ = -3.0f;
-
-const char* vertexShaderSource = R"(
-#version 130
-in vec3 vPos;
-in vec3 vColor;
-out vec3 ourColor;
-uniform mat4 transform;
-uniform mat4 projection;
-void main() {
-    gl_Position = projection * transform * vec4(vPos, 1.0);
-    ourColor = vColor;
-}
-)";
-
-const char* fragmentShaderSource = R"(
-#version 130
-in vec3 ourColor;
-out vec4 FragColor;
-void main() {
-    FragColor = vec4(ourColor, 1.0);
-}
-)";
-
-GLuint createShaderProgram(const char* vsrc, const char* fsrc) {
-    GLint success; GLchar infoLog[512];
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vsrc, nullptr);
-    glCompileShader(vs);
-    glGetShaderiv(vs, GL_COMPILE_STATUS, &success);
-    if (!success) { glGetShaderInfoLog(vs,512,nullptr,infoLog); std::cerr<<"VS error:\n"<<infoLog<<std::endl; }
-
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fsrc, nullptr);
-    glCompileShader(fs);
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &success);
-    if (!success) { glGetShaderInfoLog(fs,512,nullptr,infoLog); std::cerr<<"FS error:\n"<<infoLog<<std::endl; }
-
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs); glAttachShader(prog, fs); glLinkProgram(prog);
-    glGetProgramiv(prog, GL_LINK_STATUS, &success);
-    if (!success) { glGetProgramInfoLog(prog,512,nullptr,infoLog); std::cerr<<"Link error:\n"<<infoLog<<std::endl; }
-    glDeleteShader(vs); glDeleteShader(fs); return prog;
-}
+// transformation parameters; key_callback marks it dirty on every edit
+Transform cubeXform = { 1.0f, Quat{}, 0.0f, 0.0f, -3.0f, true, {} };  // scale, orientation, transX/Y/Z, dirty, matrix
 
-void multMatrix(float* a, const float* b) {
-    float r[16];
-    for (int i=0;i<4;i++)
-        for (int j=0;j<4;j++) {
-            r[i*4+j]=0;
-            for (int k=0;k<4;k++)
-                r[i*4+j]+=a[i*4+k]*b[k*4+j];
-        }
-    std::memcpy(a,r,16*sizeof(float));
-}
+// Rotation keys step this target by fixed quaternions built once at startup
+// (no trig per key press); the frame loop slerps cubeXform.orientation towards it.
+Quat targetOrientation;
+const float ROTATE_STEP = 0.1f, ROTATE_EASE = 12.0f;
+const Quat STEP_X_POS = quatAxisAngle(1,0,0, ROTATE_STEP), STEP_X_NEG = quatAxisAngle(1,0,0,-ROTATE_STEP);
+const Quat STEP_Y_POS = quatAxisAngle(0,1,0, ROTATE_STEP), STEP_Y_NEG = quatAxisAngle(0,1,0,-ROTATE_STEP);
 
-void makeTransform(float* m) {
-    // identity
-    std::memset(m, 0, 16*sizeof(float));
-    m[0]=m[5]=m[10]=m[15]=1.0f;
+// X steps turn about the cube's own axis (applied first), Y steps about the world
+// axis (applied last), which is exactly how the old rotX / rotY Euler angles behaved.
+void rotateTarget(const Quat& step, bool local) {
+    targetOrientation = quatRenormalize(local ? quatMul(targetOrientation, step) : quatMul(step, targetOrientation));
+}
 
-    // Scale
-    float S[16]={scaleVal,0,0,0, 0,scaleVal,0,0, 0,0,scaleVal,0, 0,0,0,1};
-    multMatrix(m,S);
+// Shader sources live in shaders/: cube.vert, or cube_instanced.vert /
+// cube_per_draw.vert for the --instances modes, with cube.frag. With
+// --procedural they are built with PROCEDURAL defined and cube_procedural.glsl
+// put in front of the vertex shader, and make the cube's vertices from
+// gl_VertexID, so there is no vertex data or index buffer.
+const char* SHADER_DIR = "shaders";
 
-    // Rotate X
-    float cx=cos(rotX), sx=sin(rotX);
-    float Rx[16]={1,0,0,0, 0,cx,sx,0, 0,-sx,cx,0, 0,0,0,1};
-    multMatrix(m,Rx);
+// ----------------- Instanced mode -----------------
+// A grid of small cubes filling the original cube's volume, each spinning at its
+// own rate. All per-cube state is structure-of-arrays for TransformBatch.
+struct CubeField {
+    TransformBatch batch;
+    std::vector<float> spinX, spinY, colors;
+};
 
-    // Rotate Y
-    float cy=cos(rotY), sy=sin(rotY);
-    float Ry[16]={cy,0,-sy,0, 0,1,0,0, sy,0,cy,0, 0,0,0,1};
-    multMatrix(m,Ry);
+void setupField(CubeField& f, int count) {
+    int side = 1;
+    while (side*side*side < count) side++;
+    float cell = 1.0f / side;
+    f.batch.resize(count);
+    f.spinX.resize(count); f.spinY.resize(count); f.colors.resize(count*3);
+    for (int i=0; i<count; i++) {
+        int x = i % side, y = (i / side) % side, z = i / (side*side);
+        f.batch.scale[i] = 0.6f * cell;
+        f.batch.rotX[i] = 0.37f * i; f.batch.rotY[i] = 0.11f * i;
+        f.batch.transX[i] = (x + 0.5f) * cell - 0.5f;
+        f.batch.transY[i] = (y + 0.5f) * cell - 0.5f;
+        f.batch.transZ[i] = (z + 0.5f) * cell - 0.5f;
+        f.spinX[i] = 0.5f + 0.013f * (i % 97);
+        f.spinY[i] = 0.3f + 0.017f * (i % 89);
+        f.colors[i*3+0] = 0.5f + 0.5f * x * cell;
+        f.colors[i*3+1] = 0.5f + 0.5f * y * cell;
+        f.colors[i*3+2] = 0.5f + 0.5f * z * cell;
+    }
+}
 
-    // Translate
-    float T[16]={1,0,0,0, 0,1,0,0, 0,0,1,0, transX,transY,transZ,1};
-    multMatrix(m,T);
+void animateField(CubeField& f, float dt) {
+    float* rx = f.batch.rotX.data(); float* ry = f.batch.rotY.data();
+    const float* sx = f.spinX.data(); const float* sy = f.spinY.data();
+    for (size_t i=0, n=f.batch.size(); i<n; i++) { rx[i] += sx[i]*dt; ry[i] += sy[i]*dt; }
 }
 
+// frames/sec and CPU time spent building and submitting each frame (excluding
+// the swap), printed once per second
+struct FrameStats {
+    int frames = 0;
+    double cpuSeconds = 0.0, windowStart = 0.0;
+    const StreamBuffer* ring = nullptr;
+    const GlState* gl = nullptr;
+    unsigned long filteredAtStart = 0;
+    const ShaderProgram* program = nullptr;
+    UniformCache::Counters uniformsAtStart;
+
+    void add(double cpu, double now, const char* label, int count) {
+        frames++; cpuSeconds += cpu;
+        if (now - windowStart < 1.0) return;
+        std::cout << count << " cubes, " << label << ": " << frames / (now - windowStart) << " fps, "
+                  << 1000.0 * cpuSeconds / frames << " ms cpu/frame";
+        if (ring) std::cout << ", " << ring->stalls() << " ring stalls";
+        if (gl) {
+            std::cout << ", " << double(gl->counters().filtered - filteredAtStart) / frames << " state calls/frame filtered";
+            filteredAtStart = gl->counters().filtered;
+        }
+        if (program) {
+            const UniformCache::Counters& u = program->uniformCounters();
+            std::cout << ", uniform uploads skipped/sent " << double(u.hits - uniformsAtStart.hits) / frames
+                      << "/" << double(u.misses - uniformsAtStart.misses) / frames;
+            uniformsAtStart = u;
+        }
+        std::cout << std::endl;
+        frames = 0; cpuSeconds = 0.0; windowStart = now;
+    }
+};
+
 // keyboard input
 void key_callback(GLFWwindow*, int key, int, int action, int) {
     if (action != GLFW_PRESS && action != GLFW_REPEAT) return;
@@ -100,33 +120,59 @@ void key_callback(GLFWwindow*, int key, int, int action, int) {
             std::cout << "Mode: " << (currentMode==SCALE?"Scale":currentMode==ROTATE?"Rotate":"Translate") << std::endl;
             break;
         case GLFW_KEY_UP:
-            if (currentMode==SCALE) scaleVal += 0.1f;
-            else if (currentMode==ROTATE) rotX += 0.1f;
-            else if (currentMode==TRANSLATE) transY += 0.1f;
+            if (currentMode==SCALE) cubeXform.scale += 0.1f;
+            else if (currentMode==ROTATE) rotateTarget(STEP_X_POS, true);
+            else if (currentMode==TRANSLATE) cubeXform.transY += 0.1f;
+            cubeXform.dirty = true;
             break;
         case GLFW_KEY_DOWN:
-            if (currentMode==SCALE) scaleVal -= 0.1f;
-            else if (currentMode==ROTATE) rotX -= 0.1f;
-            else if (currentMode==TRANSLATE) transY -= 0.1f;
+            if (currentMode==SCALE) cubeXform.scale -= 0.1f;
+            else if (currentMode==ROTATE) rotateTarget(STEP_X_NEG, true);
+            else if (currentMode==TRANSLATE) cubeXform.transY -= 0.1f;
+            cubeXform.dirty = true;
             break;
         case GLFW_KEY_LEFT:
-            if (currentMode==ROTATE) rotY -= 0.1f;
-            else if (currentMode==TRANSLATE) transX -= 0.1f;
+            if (currentMode==ROTATE) rotateTarget(STEP_Y_NEG, false);
+            else if (currentMode==TRANSLATE) cubeXform.transX -= 0.1f;
+            cubeXform.dirty = true;
             break;
         case GLFW_KEY_RIGHT:
-            if (currentMode==ROTATE) rotY += 0.1f;
-            else if (currentMode==TRANSLATE) transX += 0.1f;
+            if (currentMode==ROTATE) rotateTarget(STEP_Y_POS, false);
+            else if (currentMode==TRANSLATE) cubeXform.transX += 0.1f;
+            cubeXform.dirty = true;
             break;
         case GLFW_KEY_EQUAL: case GLFW_KEY_KP_ADD:
-            if (currentMode==TRANSLATE) transZ += 0.1f;
+            if (currentMode==TRANSLATE) cubeXform.transZ += 0.1f;
+            cubeXform.dirty = true;
             break;
         case GLFW_KEY_MINUS: case GLFW_KEY_KP_SUBTRACT:
-            if (currentMode==TRANSLATE) transZ -= 0.1f;
+            if (currentMode==TRANSLATE) cubeXform.transZ -= 0.1f;
+            cubeXform.dirty = true;
             break;
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    auto processStart = std::chrono::steady_clock::now();
+    int instanceCount = 0, maxFrames = 0;
+    bool individualDraws = false, programCacheOn = true, startupTime = false, hotReload = false, overdraw = false;
+    bool procedural = false;
+    for (int i=1; i<argc; i++) {
+        if (!std::strcmp(argv[i], "--instances") && i+1 < argc) instanceCount = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--individual")) individualDraws = true;
+        else if (!std::strcmp(argv[i], "--no-program-cache")) programCacheOn = false;
+        else if (!std::strcmp(argv[i], "--startup-time")) startupTime = true;
+        else if (!std::strcmp(argv[i], "--hot-reload")) hotReload = true;
+        else if (!std::strcmp(argv[i], "--overdraw")) overdraw = true;
+        else if (!std::strcmp(argv[i], "--frames") && i+1 < argc) maxFrames = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--procedural")) procedural = true;
+        else {
+            std::cerr << "usage: cube [--instances N [--individual]] [--no-program-cache] [--startup-time] [--hot-reload]\n"
+                      << "            [--overdraw] [--frames N] [--procedural]" << std::endl;
+            return -1;
+        }
+    }
+
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,2);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,1);
@@ -135,55 +181,283 @@ int main() {
     glfwMakeContextCurrent(window);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return -1;
     glfwSetKeyCallback(window,key_callback);
+    if (overdraw && !OverdrawMeter::supported()) {
+        std::cerr << "--overdraw needs OpenGL 3.2 (framebuffer objects and fences)" << std::endl;
+        return -1;
+    }
+    if (instanceCount > 0 && !GLAD_GL_VERSION_3_3) {
+        std::cerr << "--instances needs OpenGL 3.3 (instanced draws with attribute divisors)" << std::endl;
+        return -1;
+    }
+    // measure the renderer, not the display's refresh rate
+    if (instanceCount > 0) glfwSwapInterval(0);
 
-    GLuint program = createShaderProgram(vertexShaderSource,fragmentShaderSource);
-    glUseProgram(program);
-
-    float vertices[]={
-        -0.5f,-0.5f,-0.5f, 1,0,0,
-         0.5f,-0.5f,-0.5f, 0,1,0,
-         0.5f, 0.5f,-0.5f, 0,0,1,
-        -0.5f, 0.5f,-0.5f, 1,1,0,
-        -0.5f,-0.5f, 0.5f, 1,0,1,
-         0.5f,-0.5f, 0.5f, 0,1,1,
-         0.5f, 0.5f, 0.5f, 1,1,1,
-        -0.5f, 0.5f, 0.5f, 0,0,0
+    std::string vsName = instanceCount == 0 ? "cube.vert" : individualDraws ? "cube_per_draw.vert" : "cube_instanced.vert";
+    // the sources a build needs: the vertex shader, cube.frag and with
+    // --procedural the shared cube vertex code
+    auto loadSources = [&](std::string& vs, std::string& fs, std::string& cubeVertex) {
+        return loadShaderSource(std::string(SHADER_DIR) + "/" + vsName, vs) &&
+               loadShaderSource(std::string(SHADER_DIR) + "/cube.frag", fs) &&
+               (!procedural || loadShaderSource(std::string(SHADER_DIR) + "/cube_procedural.glsl", cubeVertex));
+    };
+    std::string vsrc, fsrc, cubeVertex;
+    if (!loadSources(vsrc, fsrc, cubeVertex)) return -1;
+    auto buildStart = std::chrono::steady_clock::now();
+    ProgramBinaryCache programCache;
+    programCacheOn = programCacheOn && programCache.open(".shader_cache");
+    // Attribute locations are fixed before linking, so a reloaded program fits
+    // the same VAO; a mat4 attribute takes four consecutive locations.
+    auto configure = [&](ShaderProgram& p, const std::string& cubeVertex) {
+        p.bindAttribute(0, "vPos");  p.bindAttribute(1, "vColor");
+        p.bindAttribute(2, "iColor"); p.bindAttribute(3, "iModel");
+        if (programCacheOn) p.useBinaryCache(&programCache);
+        if (procedural) {
+            p.define("PROCEDURAL");
+            p.prependToVertex(cubeVertex);
+        }
     };
-    unsigned int indices[]={0,1,2,2,3,0,1,5,6,6,2,1,5,4,7,7,6,5,4,0,3,3,7,4,3,2,6,6,7,3,4,5,1,1,0,4};
+    ShaderProgram program;
+    configure(program, cubeVertex);
+    // link results are not needed until the attributes are looked up
+    program.submit(vsrc.c_str(),fsrc.c_str(),"cube");
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    GlState gl;
 
-    GLuint VAO,VBO,EBO;
+    // the procedural cube still needs a VAO, which then holds the per-instance
+    // attributes, if any, and attribute 0 on zeros: the 2.1 compatibility
+    // context only transfers a vertex when attribute 0 is enabled (Mesa draws
+    // without). vPos, bound to 0, is compiled out, so nothing reads them.
+    GLuint VAO,VBO=0,EBO=0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_BYTE;
     glGenVertexArrays(1,&VAO);
-    glGenBuffers(1,&VBO);
-    glGenBuffers(1,&EBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER,VBO);
-    glBufferData(GL_ARRAY_BUFFER,sizeof(vertices),vertices,GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,sizeof(indices),indices,GL_STATIC_DRAW);
-    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    GLint transformLoc=glGetUniformLocation(program,"transform");
-    GLint projLoc=glGetUniformLocation(program,"projection");
-    float aspect=1.0f, fov=1.0f/tan(45.0f*3.14159f/360.0f);
-    float proj[16]={fov/aspect,0,0,0, 0,fov,0,0, 0,0,-1,-1, 0,0,-0.2,0};
-    glUniformMatrix4fv(projLoc,1,GL_FALSE,proj);
-    glEnable(GL_DEPTH_TEST);
-
-    while(!glfwWindowShouldClose(window)){
-        glClearColor(0.1f,0.1f,0.1f,1.0f);
+    gl.bindVertexArray(VAO);
+    if (!procedural) {
+        std::vector<float> vertices={
+            -0.5f,-0.5f,-0.5f, 1,0,0,
+             0.5f,-0.5f,-0.5f, 0,1,0,
+             0.5f, 0.5f,-0.5f, 0,0,1,
+            -0.5f, 0.5f,-0.5f, 1,1,0,
+            -0.5f,-0.5f, 0.5f, 1,0,1,
+             0.5f,-0.5f, 0.5f, 0,1,1,
+             0.5f, 0.5f, 0.5f, 1,1,1,
+            -0.5f, 0.5f, 0.5f, 0,0,0
+        };
+        std::vector<std::uint32_t> indices={0,1,2,2,3,0,1,5,6,6,2,1,5,4,7,7,6,5,4,0,3,3,7,4,3,2,6,6,7,3,4,5,1,1,0,4};
+        // faces in an order that reuses the vertices the last ones transformed
+        optimizeMesh(vertices, 6, indices);
+        indexCount = GLsizei(indices.size());
+        // the narrowest type that reaches every vertex: 8-bit for the 8 corners
+        int indexSize = indexBytes(std::uint32_t(vertices.size()/6 - 1));
+        indexType = indexSize == 1 ? GL_UNSIGNED_BYTE : indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        std::vector<unsigned char> indexData;
+        appendIndices(indexData, indices, indexSize);
+
+        glGenBuffers(1,&VBO);
+        glGenBuffers(1,&EBO);
+        gl.bindBuffer(GL_ARRAY_BUFFER,VBO);
+        glBufferData(GL_ARRAY_BUFFER,vertices.size()*sizeof(float),vertices.data(),GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,indexData.size(),indexData.data(),GL_STATIC_DRAW);
+    } else {
+        std::vector<float> zeros(36);
+        glGenBuffers(1,&VBO);
+        gl.bindBuffer(GL_ARRAY_BUFFER,VBO);
+        glBufferData(GL_ARRAY_BUFFER,zeros.size()*sizeof(float),zeros.data(),GL_STATIC_DRAW);
+        glVertexAttribPointer(0,1,GL_FLOAT,GL_FALSE,0,(void*)0);
+        glEnableVertexAttribArray(0);
+    }
+    buildStart = std::chrono::steady_clock::now();
+    if (!program.wait()) return -1;
+    buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    gl.useProgram(program.id());
+    if (!procedural) {
+        GLint posAttr=program.attribute("vPos"), colAttr=program.attribute("vColor");
+        glVertexAttribPointer(posAttr,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)0);
+        glEnableVertexAttribArray(posAttr);
+        glVertexAttribPointer(colAttr,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)(3*sizeof(float)));
+        glEnableVertexAttribArray(colAttr);
+    }
+    // one cube, or instances of it; the procedural shaders make the 36
+    // vertices of the index list themselves
+    auto drawCubes = [&](GLsizei instances) {
+        if (procedural && instances > 1) glDrawArraysInstanced(GL_TRIANGLES,0,36,instances);
+        else if (procedural) glDrawArrays(GL_TRIANGLES,0,36);
+        else if (instances > 1) glDrawElementsInstanced(GL_TRIANGLES,indexCount,indexType,0,instances);
+        else glDrawElements(GL_TRIANGLES,indexCount,indexType,0);
+    };
+
+    FrameStats stats;
+    stats.gl = &gl;
+    stats.program = &program;
+    CubeField field;
+    std::vector<float> models;
+    StreamBuffer instanceRing;
+    GLint modelAttr = -1;
+    GLuint colorVBO = 0;
+    if (instanceCount > 0) {
+        setupField(field, instanceCount);
+        if (individualDraws) {
+            models.resize(size_t(instanceCount) * 16);
+        } else {
+            // per-instance tint never changes; the matrices are refilled every frame
+            GLint colorAttr = program.attribute("iColor");
+            glGenBuffers(1, &colorVBO);
+            gl.bindBuffer(GL_ARRAY_BUFFER, colorVBO);
+            glBufferData(GL_ARRAY_BUFFER, field.colors.size()*sizeof(float), field.colors.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(colorAttr, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
+            glEnableVertexAttribArray(colorAttr);
+            glVertexAttribDivisor(colorAttr, 1);
+
+            // a mat4 attribute takes four consecutive locations, one per column;
+            // the matrices are streamed through a ring holding three frames
+            modelAttr = program.attribute("iModel");
+            instanceRing.create(GLsizeiptr(instanceCount)*16*sizeof(float)*3 + 256);
+            for (int c=0; c<4; c++) {
+                glEnableVertexAttribArray(modelAttr+c);
+                glVertexAttribDivisor(modelAttr+c, 1);
+            }
+            stats.ring = &instanceRing;
+        }
+    }
+
+    // 45 degree fov, square window, near plane at 0.1, far plane at infinity
+    constexpr Mat4 proj = InfinitePerspective(cxRadians(45.0f), 1.0f, 0.1f);
+    UniformMat4 transformUniform, projUniform, modelUniform;
+    UniformVec3 tintUniform;
+    // resolves the handles and sets what is not uploaded every frame; again
+    // after every reload, since a new program starts out with all uniforms zero
+    auto useProgram = [&]() {
+        gl.useProgram(program.id());
+        transformUniform = program.uniform<GL_FLOAT_MAT4>("transform");
+        projUniform = program.uniform<GL_FLOAT_MAT4>("projection");
+        if (instanceCount > 0 && individualDraws) {
+            modelUniform = program.uniform<GL_FLOAT_MAT4>("model");
+            tintUniform = program.uniform<GL_FLOAT_VEC3>("tint");
+        }
+        program.set(projUniform,proj.data());
+    };
+    useProgram();
+    gl.enable(GL_DEPTH_TEST);
+
+    // --hot-reload builds into staged; the program it replaces is retired until
+    // the window has drawn a frame with the new one, as in shapes.cpp
+    ShaderProgram staged, retired;
+    ShaderReloader reloader;
+    if (hotReload) {
+        std::vector<std::string> files = { vsName, "cube.frag" };
+        if (procedural) files.push_back("cube_procedural.glsl");
+        reloader.add({ "cube", files,
+            [&]() {
+                std::string vs, fs, cubeVertex;
+                if (!loadSources(vs, fs, cubeVertex)) return false;
+                staged.destroy();
+                staged = ShaderProgram();
+                configure(staged, cubeVertex);
+                return staged.build(vs.c_str(), fs.c_str(), "cube");
+            },
+            [&]() {
+                std::swap(program, staged);
+                useProgram();
+                retired = std::move(staged);
+            } });
+        reloader.start(SHADER_DIR, window);
+    }
+
+    // --overdraw: fragments that pass the depth test, per pixel, reported once a second
+    OverdrawMeter overdrawMeter;
+    OverdrawMeter::Histogram overdrawReported;
+
+    double lastTime = glfwGetTime();
+    stats.windowStart = lastTime;
+    double overdrawStart = lastTime;
+    // --frames N: quit after N frames, for scripted runs
+    for (int frame=0; !glfwWindowShouldClose(window) && (maxFrames <= 0 || frame < maxFrames); frame++) {
+        auto cpuStart = std::chrono::steady_clock::now();
+        // a new program counts its uniform uploads from zero
+        if (reloader.poll()) stats.uniformsAtStart = UniformCache::Counters();
+        double now = glfwGetTime();
+        float dt = float(now - lastTime);
+        lastTime = now;
+
+        // ease towards the key-driven orientation; nothing to do once it arrives
+        Quat& q = cubeXform.orientation;
+        if (q.w != targetOrientation.w || q.x != targetOrientation.x ||
+            q.y != targetOrientation.y || q.z != targetOrientation.z) {
+            if (std::fabs(quatDot(q, targetOrientation)) > 0.999999f) q = targetOrientation;
+            else q = quatSlerp(q, targetOrientation, std::fmin(1.0f, dt * ROTATE_EASE));
+            cubeXform.dirty = true;
+        }
+
+        if (overdraw) {
+            int fw, fh;
+            glfwGetFramebufferSize(window, &fw, &fh);
+            overdrawMeter.begin(fw, fh);
+        }
+        gl.clearColor(0.1f,0.1f,0.1f,1.0f);
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 
-        float m[16]; makeTransform(m);
-        glUniformMatrix4fv(transformLoc,1,GL_FALSE,m);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,36,GL_UNSIGNED_INT,0);
+        // recomposed only after an edit; the cache drops the upload when nothing changed
+        cubeXform.update();
+        program.set(transformUniform,cubeXform.matrix);
+        gl.bindVertexArray(VAO);
+        if (instanceCount == 0) {
+            drawCubes(1);
+        } else if (individualDraws) {
+            animateField(field, dt);
+            field.batch.compose(models.data());
+            for (int i=0; i<instanceCount; i++) {
+                program.set(modelUniform,&models[size_t(i)*16]);
+                program.set(tintUniform,&field.colors[size_t(i)*3]);
+                drawCubes(1);
+            }
+        } else {
+            animateField(field, dt);
+            // write this frame's matrices straight into the ring, then point iModel at them
+            StreamBuffer::Allocation a = instanceRing.map(GLsizeiptr(instanceCount)*16*sizeof(float));
+            if (a.ptr) {
+                field.batch.compose((float*)a.ptr);
+                instanceRing.unmap(a);
+                gl.bindBuffer(GL_ARRAY_BUFFER, instanceRing.buffer());
+                for (int c=0; c<4; c++)
+                    glVertexAttribPointer(modelAttr+c, 4, GL_FLOAT, GL_FALSE, 16*sizeof(float),
+                                          (void*)(a.offset + c*4*sizeof(float)));
+                drawCubes(instanceCount);
+            }
+            instanceRing.endFrame();
+        }
 
+        if (instanceCount > 0) {
+            double cpu = std::chrono::duration<double>(std::chrono::steady_clock::now() - cpuStart).count();
+            stats.add(cpu, now, individualDraws ? "individual draws" : "instanced", instanceCount);
+        }
+        if (overdraw) {
+            overdrawMeter.end();
+            if (now - overdrawStart >= 1.0) {
+                printOverdraw("overdraw", overdrawMeter, overdrawReported);
+                overdrawReported = overdrawMeter.histogram();
+                overdrawStart = now;
+            }
+        }
         glfwSwapBuffers(window);
+        // Only this context ever drew with the retired program, so deleting it
+        // here frees its shaders at once and leaves no other context to free
+        // them at a later flush: unlike shapes.cpp's windows, nothing needs
+        // resyncing (see resyncShaders() there).
+        retired.destroy();
+        if (startupTime) {
+            glFinish();
+            printStartupTime(processStart, buildSeconds, programCache);
+            startupTime = false;
+        }
         glfwPollEvents();
     }
+    if (overdraw) {
+        overdrawMeter.finish();
+        printOverdraw("overdraw (whole run)", overdrawMeter, OverdrawMeter::Histogram());
+        overdrawMeter.destroy();
+    }
+    reloader.stop();
     glfwTerminate();
     return 0;
 }
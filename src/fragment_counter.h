@@ -0,0 +1,72 @@
+#pragma once
+// Counts the fragments a context rasterizes per frame with GL_SAMPLES_PASSED
+// queries, without ever waiting for the GPU: each frame's query is read back
+// a few frames later, once its result is available, and a frame that finds
+// every query still in flight is simply not measured.
+//
+// With depth and stencil testing off (as in part1) every fragment passes, so
+// the count is the number of fragment shader runs, overdraw included.
+// Query objects are not shared between contexts: keep one counter per
+// context and only call it with that context current.
+
+#include <glad/glad.h>
+
+class FragmentCounter {
+public:
+    struct Counters { unsigned long long fragments = 0; unsigned long frames = 0; };
+
+    // Around everything drawn in one frame; clears do not count.
+    void begin() {
+        if (!queries[0]) glGenQueries(RING, queries);
+        collect();
+        active = !pending[next];
+        if (active) glBeginQuery(GL_SAMPLES_PASSED, queries[next]);
+    }
+
+    void end() {
+        if (!active) return;
+        glEndQuery(GL_SAMPLES_PASSED);
+        pending[next] = true;
+        next = (next + 1) % RING;
+        active = false;
+    }
+
+    // Waits for the queries still in flight, e.g. before a final report.
+    void finish() {
+        glFinish();
+        collect();
+    }
+
+    // Frames whose results have arrived so far.
+    const Counters& counters() const { return count; }
+
+    void destroy() {
+        if (queries[0]) glDeleteQueries(RING, queries);
+        *this = FragmentCounter();
+    }
+
+private:
+    static const int RING = 4;
+
+    // oldest first; results arrive in submission order
+    void collect() {
+        for (int k=0; k<RING; k++) {
+            int i = (next + k) % RING;
+            if (!pending[i]) continue;
+            GLuint ready = 0;
+            glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready) break;
+            GLuint n = 0;
+            glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT, &n);
+            count.fragments += n;
+            count.frames++;
+            pending[i] = false;
+        }
+    }
+
+    GLuint queries[RING] = {};
+    bool pending[RING] = {};
+    int next = 0;
+    bool active = false;
+    Counters count;
+};
@@ -0,0 +1,49 @@
+#pragma once
+// Counts calls to selected GL entry points, for --stats style reporting.
+//
+// glad exposes every entry point as a function pointer (glFoo is a macro for
+// glad_glFoo), so counting is a matter of swapping that pointer for a trampoline
+// that bumps glCallCount and forwards to the real function. Nothing is wrapped
+// unless countGlCalls() is called, so the normal path pays nothing.
+//
+// The count is per thread: other threads calling GL (the hot reload watcher
+// rebuilding programs) neither race with the render thread's count nor
+// inflate its per-frame figures.
+
+#include <glad/glad.h>
+
+inline thread_local unsigned long glCallCount = 0;
+
+template <auto* Slot, class Fn> struct CountedGlCall;
+
+template <auto* Slot, class R, class... A>
+struct CountedGlCall<Slot, R (APIENTRYP)(A...)> {
+    static inline R (APIENTRYP real)(A...) = nullptr;
+    static R APIENTRY call(A... a) { glCallCount++; return real(a...); }
+    static void install() {
+        if (real || !*Slot) return;   // already wrapped / not loaded
+        real = *Slot;
+        *Slot = call;
+    }
+};
+
+// Call after gladLoadGL*; covers the entry points the frame loops use.
+#define COUNT_GL_CALL(name) CountedGlCall<&glad_##name, decltype(glad_##name)>::install()
+inline void countGlCalls() {
+    COUNT_GL_CALL(glClear);               COUNT_GL_CALL(glClearColor);
+    COUNT_GL_CALL(glViewport);            COUNT_GL_CALL(glEnable);
+    COUNT_GL_CALL(glDisable);             COUNT_GL_CALL(glUseProgram);
+    COUNT_GL_CALL(glUniform1f);           COUNT_GL_CALL(glUniform1i);
+    COUNT_GL_CALL(glUniform2f);           COUNT_GL_CALL(glUniform3f);
+    COUNT_GL_CALL(glUniform3fv);          COUNT_GL_CALL(glUniformMatrix4fv);
+    COUNT_GL_CALL(glBindVertexArray);     COUNT_GL_CALL(glBindBuffer);
+    COUNT_GL_CALL(glBindBufferRange);     COUNT_GL_CALL(glBufferData);
+    COUNT_GL_CALL(glVertexAttribPointer); COUNT_GL_CALL(glEnableVertexAttribArray);
+    COUNT_GL_CALL(glMapBufferRange);      COUNT_GL_CALL(glFlushMappedBufferRange);
+    COUNT_GL_CALL(glUnmapBuffer);         COUNT_GL_CALL(glDrawArrays);
+    COUNT_GL_CALL(glDrawArraysInstanced); COUNT_GL_CALL(glDrawElements);
+    COUNT_GL_CALL(glFenceSync);           COUNT_GL_CALL(glClientWaitSync);
+    COUNT_GL_CALL(glWaitSync);            COUNT_GL_CALL(glDeleteSync);
+    COUNT_GL_CALL(glFlush);
+}
+#undef COUNT_GL_CALL
@@ -0,0 +1,138 @@
+#pragma once
+// Shadow of the GL state the frame loops keep setting, so calls that would not
+// change anything never reach the driver.
+//
+// Keep one GlState per context (bindings are per-context state even when the
+// objects are shared) and route the tracked calls through it. Everything starts
+// out unknown, so the first call of each kind is always issued. GL calls made
+// behind its back that change tracked state (or delete a bound object) must be
+// followed by invalidate().
+//
+// GL_ELEMENT_ARRAY_BUFFER is not shadowed: it belongs to the bound VAO, and
+// bindVertexArray() would silently change it. Neither are the copy targets,
+// which StreamBuffer binds for itself.
+
+#include <glad/glad.h>
+
+class GlState {
+public:
+    struct Counters { unsigned long issued = 0, filtered = 0; };
+
+    GlState() {}
+
+    const Counters& counters() const { return count; }
+
+    void invalidate() { *this = GlState(count); }
+
+    // The program last passed to useProgram(), ~0u while unknown.
+    GLuint currentProgram() const { return program; }
+
+    void useProgram(GLuint p) {
+        if (!changed(program, p)) return;
+        glUseProgram(p);
+    }
+
+    void bindVertexArray(GLuint vao) {
+        if (!changed(vertexArray, vao)) return;
+        glBindVertexArray(vao);
+    }
+
+    void bindBuffer(GLenum target, GLuint id) {
+        GLuint* slot = bufferSlot(target);
+        if (slot && !changed(*slot, id)) return;
+        if (!slot) count.issued++;
+        glBindBuffer(target, id);
+    }
+
+    // Indexed uniform buffer binding; also sets the generic GL_UNIFORM_BUFFER binding.
+    void bindBufferRange(GLenum target, GLuint index, GLuint id, GLintptr offset, GLsizeiptr size) {
+        if (target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BINDINGS) {
+            Range& r = uniformRanges[index];
+            if (r.buffer == id && r.offset == offset && r.size == size && uniformBuffer == id) {
+                count.filtered++;
+                return;
+            }
+            r = { id, offset, size };
+            uniformBuffer = id;
+        } else if (GLuint* slot = bufferSlot(target)) {
+            *slot = id;
+        }
+        count.issued++;
+        glBindBufferRange(target, index, id, offset, size);
+    }
+
+    void viewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+        if (viewportKnown && viewportBox[0] == x && viewportBox[1] == y &&
+            viewportBox[2] == w && viewportBox[3] == h) { count.filtered++; return; }
+        viewportKnown = true;
+        viewportBox[0] = x; viewportBox[1] = y; viewportBox[2] = w; viewportBox[3] = h;
+        count.issued++;
+        glViewport(x, y, w, h);
+    }
+
+    void clearColor(float r, float g, float b, float a) {
+        if (clearKnown && clear[0] == r && clear[1] == g && clear[2] == b && clear[3] == a) {
+            count.filtered++;
+            return;
+        }
+        clearKnown = true;
+        clear[0] = r; clear[1] = g; clear[2] = b; clear[3] = a;
+        count.issued++;
+        glClearColor(r, g, b, a);
+    }
+
+    void enable(GLenum cap)  { setCap(cap, true); }
+    void disable(GLenum cap) { setCap(cap, false); }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+    static const int MAX_UNIFORM_BINDINGS = 16;
+    struct Range { GLuint buffer = UNKNOWN; GLintptr offset = 0; GLsizeiptr size = 0; };
+
+    explicit GlState(const Counters& c) : count(c) {}
+
+    bool changed(GLuint& shadow, GLuint value) {
+        if (shadow == value) { count.filtered++; return false; }
+        shadow = value;
+        count.issued++;
+        return true;
+    }
+
+    GLuint* bufferSlot(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER:   return &arrayBuffer;
+            case GL_UNIFORM_BUFFER: return &uniformBuffer;
+            default:                return nullptr;
+        }
+    }
+
+    // caps the programs toggle; anything else is passed straight through
+    int capIndex(GLenum cap) const {
+        switch (cap) {
+            case GL_DEPTH_TEST:   return 0;
+            case GL_BLEND:        return 1;
+            case GL_CULL_FACE:    return 2;
+            case GL_SCISSOR_TEST: return 3;
+            default:              return -1;
+        }
+    }
+    void setCap(GLenum cap, bool on) {
+        int i = capIndex(cap);
+        if (i >= 0) {
+            signed char v = on ? 1 : 0;
+            if (caps[i] == v) { count.filtered++; return; }
+            caps[i] = v;
+        }
+        count.issued++;
+        if (on) glEnable(cap); else glDisable(cap);
+    }
+
+    Counters count;
+    GLuint program = UNKNOWN, vertexArray = UNKNOWN;
+    GLuint arrayBuffer = UNKNOWN, uniformBuffer = UNKNOWN;
+    Range uniformRanges[MAX_UNIFORM_BINDINGS];
+    bool viewportKnown = false, clearKnown = false;
+    GLint viewportBox[4] = {};
+    float clear[4] = {};
+    signed char caps[4] = { -1, -1, -1, -1 };   // -1 unknown, else 0 / 1
+};
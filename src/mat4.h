@@ -0,0 +1,109 @@
+#pragma once
+// 4x4 float matrix kernels on flat float[16] arrays.
+// Layout matches cube.cpp: m[i*4+j] is row i, column j, points are row vectors
+// (p' = p * M, translation in the last row) and the array is uploaded to GL with
+// transpose = GL_FALSE.
+
+#include "simd.h"
+#include <cstddef>
+
+// r = a * b. r may alias a or b.
+inline void mat4Mul(float* r, const float* a, const float* b) {
+#if defined(SIMD_SSE) && defined(__AVX__)
+    // two result rows per 256-bit register
+    __m256 b0 = _mm256_broadcast_ps((const __m128*)(b));
+    __m256 b1 = _mm256_broadcast_ps((const __m128*)(b+4));
+    __m256 b2 = _mm256_broadcast_ps((const __m128*)(b+8));
+    __m256 b3 = _mm256_broadcast_ps((const __m128*)(b+12));
+    __m256 a01 = _mm256_loadu_ps(a), a23 = _mm256_loadu_ps(a+8);
+    __m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01,a01,0x00), b0);
+    __m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23,a23,0x00), b0);
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01,a01,0x55), b1));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23,a23,0x55), b1));
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01,a01,0xAA), b2));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23,a23,0xAA), b2));
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01,a01,0xFF), b3));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23,a23,0xFF), b3));
+    _mm256_storeu_ps(r, r01);
+    _mm256_storeu_ps(r+8, r23);
+#else
+    // each result row is a linear combination of the rows of b
+    f32x4 b0 = simdLoad(b), b1 = simdLoad(b+4), b2 = simdLoad(b+8), b3 = simdLoad(b+12);
+    for (int i=0; i<4; i++) {
+        const float* ai = a + i*4;
+        f32x4 row = simdMul(simdSplat(ai[0]), b0);
+        row = simdMadd(simdSplat(ai[1]), b1, row);
+        row = simdMadd(simdSplat(ai[2]), b2, row);
+        row = simdMadd(simdSplat(ai[3]), b3, row);
+        simdStore(r + i*4, row);
+    }
+#endif
+}
+
+// r = transpose(a). r may alias a.
+inline void mat4Transpose(float* r, const float* a) {
+    f32x4 r0 = simdLoad(a), r1 = simdLoad(a+4), r2 = simdLoad(a+8), r3 = simdLoad(a+12);
+    simdTranspose(r0, r1, r2, r3);
+    simdStore(r, r0); simdStore(r+4, r1); simdStore(r+8, r2); simdStore(r+12, r3);
+}
+
+// r = inverse(m) by cofactor expansion. Returns false (and leaves r untouched)
+// when m is singular. r may alias m.
+inline bool mat4Inverse(float* r, const float* m) {
+    // 2x2 sub-determinants of the top two and bottom two rows
+    float s0 = m[0]*m[5]  - m[4]*m[1],  s1 = m[0]*m[6]  - m[4]*m[2];
+    float s2 = m[0]*m[7]  - m[4]*m[3],  s3 = m[1]*m[6]  - m[5]*m[2];
+    float s4 = m[1]*m[7]  - m[5]*m[3],  s5 = m[2]*m[7]  - m[6]*m[3];
+    float c0 = m[8]*m[13] - m[12]*m[9], c1 = m[8]*m[14] - m[12]*m[10];
+    float c2 = m[8]*m[15] - m[12]*m[11],c3 = m[9]*m[14] - m[13]*m[10];
+    float c4 = m[9]*m[15] - m[13]*m[11],c5 = m[10]*m[15]- m[14]*m[11];
+
+    float det = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+    if (det == 0.0f) return false;
+    float inv = 1.0f / det;
+
+    // columns of m with neighbouring lanes swapped: (m1j, m0j, m3j, m2j)
+    f32x4 t0 = simdLoad(m), t1 = simdLoad(m+4), t2 = simdLoad(m+8), t3 = simdLoad(m+12);
+    simdTranspose(t0, t1, t2, t3);
+    t0 = simdSwapPairs(t0); t1 = simdSwapPairs(t1);
+    t2 = simdSwapPairs(t2); t3 = simdSwapPairs(t3);
+
+    f32x4 k0 = simdSet(c0,c0,s0,s0), k1 = simdSet(c1,c1,s1,s1), k2 = simdSet(c2,c2,s2,s2);
+    f32x4 k3 = simdSet(c3,c3,s3,s3), k4 = simdSet(c4,c4,s4,s4), k5 = simdSet(c5,c5,s5,s5);
+    f32x4 even = simdSet(inv,-inv,inv,-inv), odd = simdSet(-inv,inv,-inv,inv);
+
+    f32x4 r0 = simdMadd(t3, k3, simdSub(simdMul(t1, k5), simdMul(t2, k4)));
+    f32x4 r1 = simdMadd(t3, k1, simdSub(simdMul(t0, k5), simdMul(t2, k2)));
+    f32x4 r2 = simdMadd(t3, k0, simdSub(simdMul(t0, k4), simdMul(t1, k2)));
+    f32x4 r3 = simdMadd(t2, k0, simdSub(simdMul(t0, k3), simdMul(t1, k1)));
+    simdStore(r,    simdMul(r0, even));
+    simdStore(r+4,  simdMul(r1, odd));
+    simdStore(r+8,  simdMul(r2, even));
+    simdStore(r+12, simdMul(r3, odd));
+    return true;
+}
+
+// out = v * m for a single homogeneous row vector. out may alias v.
+inline void mat4TransformVec4(float* out, const float* v, const float* m) {
+    f32x4 p = simdMul(simdSplat(v[0]), simdLoad(m));
+    p = simdMadd(simdSplat(v[1]), simdLoad(m+4), p);
+    p = simdMadd(simdSplat(v[2]), simdLoad(m+8), p);
+    p = simdMadd(simdSplat(v[3]), simdLoad(m+12), p);
+    simdStore(out, p);
+}
+
+// out[i] = in[i] * m for count packed vec4s, keeping m in registers.
+inline void mat4TransformVec4Array(float* out, const float* in, std::size_t count, const float* m) {
+    f32x4 m0 = simdLoad(m), m1 = simdLoad(m+4), m2 = simdLoad(m+8), m3 = simdLoad(m+12);
+    for (std::size_t i=0; i<count; i++, in+=4, out+=4) {
+        f32x4 p = simdMul(simdSplat(in[0]), m0);
+        p = simdMadd(simdSplat(in[1]), m1, p);
+        p = simdMadd(simdSplat(in[2]), m2, p);
+        p = simdMadd(simdSplat(in[3]), m3, p);
+        simdStore(out, p);
+    }
+}
+
+inline void mat4Identity(float* m) {
+    for (int i=0; i<16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
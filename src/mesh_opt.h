@@ -0,0 +1,217 @@
+#pragma once
+// Post-processing for generated triangle meshes: weld duplicate vertices into
+// an indexed mesh, reorder the triangles for the post-transform vertex cache,
+// then reorder the vertices for fetch locality.
+//
+// Vertices are interleaved floats, `stride` of them per vertex, the way the
+// builders emit them; indices describe a triangle list. None of the steps
+// changes the set of triangles or their winding, only their order and the
+// numbering of the vertices.
+//
+// The triangle order is Forsyth's "linear-speed vertex cache optimisation":
+// every vertex is scored by its place in a simulated LRU cache and by how
+// many of its triangles are still to be emitted, and the next triangle is the
+// best-scoring one among those touching the cache. The fetch order then
+// numbers vertices by first use, so the vertex buffer is read front to back.
+//
+// meshCacheStats() measures the result on a FIFO cache, as most hardware
+// has: ACMR is vertex shader runs per triangle (3 is no reuse at all, large
+// regular grids approach 0.5), ATVR runs per unique vertex (1 is ideal).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct MeshCacheStats { double acmr = 0.0, atvr = 0.0; };
+
+inline MeshCacheStats meshCacheStats(const std::vector<std::uint32_t>& indices, std::size_t vertexCount,
+                                     std::size_t cacheSize = 16) {
+    // a FIFO only changes on a miss, so v is cached while fewer than
+    // cacheSize misses have happened since it went in
+    const std::size_t NONE = ~std::size_t(0);
+    std::vector<std::size_t> missedAt(vertexCount, NONE);
+    std::size_t misses = 0, unique = 0;
+    for (std::uint32_t v : indices) {
+        if (missedAt[v] == NONE) unique++;
+        else if (misses - missedAt[v] < cacheSize) continue;
+        missedAt[v] = misses++;
+    }
+    MeshCacheStats s;
+    if (!indices.empty()) s.acmr = double(misses) / double(indices.size() / 3);
+    if (unique) s.atvr = double(misses) / double(unique);
+    return s;
+}
+
+// Replaces vertices with its distinct vertices (bitwise equal, so -0.0f and
+// 0.0f stay apart) in order of first appearance, and returns one index per
+// original vertex.
+inline std::vector<std::uint32_t> weldVertices(std::vector<float>& vertices, int stride) {
+    std::size_t count = vertices.size() / stride, bytes = stride * sizeof(float);
+    const std::uint32_t EMPTY = ~std::uint32_t(0);
+    std::size_t slots = 16;
+    while (slots < count * 2) slots *= 2;
+    std::vector<std::uint32_t> table(slots, EMPTY), indices(count);
+    std::vector<float> welded;
+    welded.reserve(vertices.size());
+    for (std::size_t i=0; i<count; i++) {
+        const float* v = &vertices[i * stride];
+        std::uint64_t h = 14695981039346656037ull;   // FNV-1a
+        for (std::size_t b=0; b<bytes; b++) { h ^= ((const unsigned char*)v)[b]; h *= 1099511628211ull; }
+        std::size_t s = std::size_t(h) & (slots - 1);
+        while (table[s] != EMPTY && std::memcmp(&welded[table[s] * stride], v, bytes) != 0)
+            s = (s + 1) & (slots - 1);
+        if (table[s] == EMPTY) {
+            table[s] = std::uint32_t(welded.size() / stride);
+            welded.insert(welded.end(), v, v + stride);
+        }
+        indices[i] = table[s];
+    }
+    vertices.swap(welded);
+    return indices;
+}
+
+// Reorders the triangles of an indexed mesh for a post-transform cache.
+inline void optimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount) {
+    const int CACHE = 32, MAX_VALENCE = 32;
+    const std::uint32_t NONE = ~std::uint32_t(0);
+    std::size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // Forsyth's weights: the last triangle's three vertices score 0.75, the
+    // rest of the cache falls off as a power curve, and vertices with few
+    // triangles left get a boost so they are finished off instead of stranded
+    static const struct Scores {
+        float cache[CACHE], valence[MAX_VALENCE + 1];
+        Scores() {
+            for (int i=0; i<CACHE; i++)
+                cache[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / (CACHE - 3), 1.5f);
+            valence[0] = 0.0f;
+            for (int i=1; i<=MAX_VALENCE; i++) valence[i] = 2.0f / std::sqrt(float(i));
+        }
+    } scores;
+    auto score = [&](int cachePos, std::uint32_t remaining) {
+        if (remaining == 0) return -1.0f;
+        return (cachePos >= 0 ? scores.cache[cachePos] : 0.0f) +
+               scores.valence[std::min<std::uint32_t>(remaining, MAX_VALENCE)];
+    };
+
+    // triangles still to be emitted, per vertex, as ranges of one array
+    std::vector<std::uint32_t> remaining(vertexCount, 0), first(vertexCount + 1, 0), adjacency(indices.size());
+    for (std::uint32_t v : indices) remaining[v]++;
+    for (std::size_t v=0; v<vertexCount; v++) first[v + 1] = first[v] + remaining[v];
+    std::vector<std::uint32_t> fill(first.begin(), first.end() - 1);
+    for (std::size_t t=0; t<triCount; t++)
+        for (int k=0; k<3; k++) adjacency[fill[indices[t * 3 + k]]++] = std::uint32_t(t);
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount), triScore(triCount);
+    for (std::size_t v=0; v<vertexCount; v++) vertexScore[v] = score(-1, remaining[v]);
+    std::uint32_t best = 0;
+    for (std::size_t t=0; t<triCount; t++) {
+        const std::uint32_t* tri = &indices[t * 3];
+        triScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+        if (triScore[t] > triScore[best]) best = std::uint32_t(t);
+    }
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<std::uint32_t> out;
+    out.reserve(indices.size());
+    std::uint32_t cache[CACHE + 3];
+    int cached = 0;
+    std::size_t cursor = 0;
+    while (out.size() < indices.size()) {
+        // nothing in the cache has triangles left: start over elsewhere
+        if (best == NONE) {
+            while (emitted[cursor]) cursor++;
+            best = std::uint32_t(cursor);
+        }
+        emitted[best] = 1;
+        const std::uint32_t* tri = &indices[std::size_t(best) * 3];
+        out.insert(out.end(), tri, tri + 3);
+        for (int k=0; k<3; k++) {
+            std::uint32_t* b = &adjacency[first[tri[k]]];
+            std::uint32_t* e = b + remaining[tri[k]];
+            *std::find(b, e, best) = *(e - 1);
+            remaining[tri[k]]--;
+        }
+
+        // the triangle's vertices move to the front; whatever falls off the
+        // end leaves the cache but is rescored all the same
+        std::uint32_t next[CACHE + 3];
+        int n = 0;
+        for (int k=0; k<3; k++) next[n++] = tri[k];
+        for (int i=0; i<cached; i++)
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2]) next[n++] = cache[i];
+        for (int i=0; i<n; i++) {
+            cachePos[next[i]] = i < CACHE ? i : -1;
+            vertexScore[next[i]] = score(cachePos[next[i]], remaining[next[i]]);
+        }
+        cached = std::min(n, CACHE);
+        std::copy(next, next + cached, cache);
+
+        best = NONE;
+        float bestScore = -1.0f;
+        for (int i=0; i<n; i++) {
+            std::uint32_t v = next[i];
+            for (std::uint32_t a=first[v], e=first[v] + remaining[v]; a<e; a++) {
+                std::uint32_t t = adjacency[a];
+                const std::uint32_t* u = &indices[std::size_t(t) * 3];
+                triScore[t] = vertexScore[u[0]] + vertexScore[u[1]] + vertexScore[u[2]];
+                if (triScore[t] > bestScore) { bestScore = triScore[t]; best = t; }
+            }
+        }
+    }
+    indices.swap(out);
+}
+
+// Renumbers vertices in order of first use and moves them to match.
+// Vertices no index refers to are dropped; returns the new vertex count.
+inline std::size_t optimizeVertexFetch(std::vector<float>& vertices, int stride, std::vector<std::uint32_t>& indices) {
+    const std::uint32_t NONE = ~std::uint32_t(0);
+    std::vector<std::uint32_t> remap(vertices.size() / stride, NONE);
+    std::vector<float> out;
+    out.reserve(vertices.size());
+    std::uint32_t count = 0;
+    for (std::uint32_t& i : indices) {
+        if (remap[i] == NONE) {
+            remap[i] = count++;
+            out.insert(out.end(), &vertices[std::size_t(i) * stride], &vertices[std::size_t(i) * stride] + stride);
+        }
+        i = remap[i];
+    }
+    vertices.swap(out);
+    return count;
+}
+
+// Both reorderings, in the order that makes sense: triangles first, then
+// vertices by the order the new triangle list reaches them.
+inline void optimizeMesh(std::vector<float>& vertices, int stride, std::vector<std::uint32_t>& indices) {
+    optimizeVertexCache(indices, vertices.size() / stride);
+    optimizeVertexFetch(vertices, stride, indices);
+}
+
+// Narrowest index width, in bytes, that can hold maxIndex: 1, 2 or 4.
+inline int indexBytes(std::uint32_t maxIndex) {
+    return maxIndex <= 0xFF ? 1 : maxIndex <= 0xFFFF ? 2 : 4;
+}
+
+// Appends indices + bias to out, bytes wide in native byte order, after
+// padding out to a multiple of the width (GL wants index offsets aligned to
+// it); returns where they start.
+inline std::size_t appendIndices(std::vector<unsigned char>& out, const std::vector<std::uint32_t>& indices,
+                                 int bytes, std::uint32_t bias = 0) {
+    out.resize((out.size() + bytes - 1) / bytes * bytes);
+    std::size_t offset = out.size();
+    out.resize(offset + indices.size() * bytes);
+    unsigned char* p = &out[offset];
+    for (std::uint32_t i : indices) {
+        std::uint32_t v = i + bias;
+        if (bytes == 1) { std::uint8_t x = std::uint8_t(v); std::memcpy(p, &x, 1); }
+        else if (bytes == 2) { std::uint16_t x = std::uint16_t(v); std::memcpy(p, &x, 2); }
+        else std::memcpy(p, &v, 4);
+        p += bytes;
+    }
+    return offset;
+}
@@ -0,0 +1,182 @@
+#pragma once
+// Per-pixel shading counts for one context's frames (GL 3.2).
+//
+// Between begin() and end() the frame renders into an offscreen framebuffer
+// whose stencil buffer counts fragments: the stencil test always passes and
+// increments on every fragment that survives the depth test, so no shader or
+// blend state has to change. end() blits the color to the window, so what is
+// shown stays the same, and reads the stencil into a pixel buffer with a
+// fence behind it. Readbacks are mapped only once their fence has signalled,
+// a few frames later, and a frame that finds all of them in flight is not
+// measured, so measuring never waits for the GPU either.
+//
+// Counts saturate at 255. Framebuffers are not shared between contexts: keep
+// one meter per context and only call it with that context current.
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+class OverdrawMeter {
+public:
+    static const int BUCKETS = 9;   // shaded 0..7 times, then 8 or more
+
+    struct Histogram {
+        unsigned long long pixels[BUCKETS] = {};
+        unsigned long long fragments = 0;
+        unsigned long frames = 0;
+        unsigned maxCount = 0;
+    };
+
+    static bool supported() { return GLAD_GL_VERSION_3_2; }
+
+    // Before the frame's clear; width x height is the window's framebuffer.
+    void begin(int width, int height) {
+        if (width != w || height != h) resize(width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glStencilMask(0xFF);
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    }
+
+    // After the frame's last draw, before the swap.
+    void end() {
+        glDisable(GL_STENCIL_TEST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        collect();
+        Readback& r = readbacks[next];
+        if (!r.fence) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+            glReadPixels(0, 0, w, h, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            next = (next + 1) % RING;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Waits for the readbacks still in flight, e.g. before a final report.
+    void finish() {
+        glFinish();
+        collect();
+    }
+
+    // Frames whose readbacks have arrived so far.
+    const Histogram& histogram() const { return hist; }
+    int width() const { return w; }
+    int height() const { return h; }
+
+    void destroy() {
+        release();
+        *this = OverdrawMeter();
+    }
+
+private:
+    static const int RING = 3;
+    struct Readback { GLuint pbo = 0; GLsync fence = nullptr; };
+
+    // rows of the packed stencil start 4-byte aligned (GL_PACK_ALIGNMENT)
+    int rowBytes() const { return (w + 3) & ~3; }
+
+    void resize(int width, int height) {
+        release();
+        w = width; h = height;
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "overdraw: framebuffer incomplete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        for (Readback& r : readbacks) {
+            glGenBuffers(1, &r.pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(rowBytes()) * h, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // oldest first; fences signal in submission order
+    void collect() {
+        for (int k=0; k<RING; k++) {
+            Readback& r = readbacks[(next + k) % RING];
+            if (!r.fence) continue;
+            if (glClientWaitSync(r.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+            glDeleteSync(r.fence);
+            r.fence = nullptr;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+            const unsigned char* p = (const unsigned char*)glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(rowBytes()) * h, GL_MAP_READ_BIT);
+            if (p) {
+                unsigned long long counts[256] = {};
+                for (int y=0; y<h; y++)
+                    for (const unsigned char* c = p + std::size_t(y) * rowBytes(), *e = c + w; c != e; ++c)
+                        counts[*c]++;
+                for (unsigned v=0; v<256; v++) {
+                    if (!counts[v]) continue;
+                    hist.pixels[std::min<unsigned>(v, BUCKETS - 1)] += counts[v];
+                    hist.fragments += counts[v] * v;
+                    hist.maxCount = std::max(hist.maxCount, v);
+                }
+                hist.frames++;
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    void release() {
+        for (Readback& r : readbacks) {
+            if (r.fence) glDeleteSync(r.fence);
+            if (r.pbo) glDeleteBuffers(1, &r.pbo);
+            r = Readback();
+        }
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (renderbuffers[0]) glDeleteRenderbuffers(2, renderbuffers);
+        fbo = 0;
+        renderbuffers[0] = renderbuffers[1] = 0;
+        next = 0;
+    }
+
+    int w = 0, h = 0;
+    GLuint fbo = 0, renderbuffers[2] = {};   // color, depth + stencil
+    Readback readbacks[RING];
+    int next = 0;
+    Histogram hist;
+};
+
+// One line per report: shading counts per frame between two histograms of
+// the same meter (since = an earlier copy, or a default one for the totals).
+// The maximum is always over the whole run.
+inline void printOverdraw(const char* label, const OverdrawMeter& meter, const OverdrawMeter::Histogram& since) {
+    const OverdrawMeter::Histogram& now = meter.histogram();
+    unsigned long frames = now.frames - since.frames;
+    if (!frames) return;
+    double pixels = double(meter.width()) * meter.height();
+    unsigned long long uncovered = now.pixels[0] - since.pixels[0];
+    double fragments = double(now.fragments - since.fragments);
+    double covered = double(frames) * pixels - double(uncovered);
+    std::cout << label << ": " << fragments / frames << " fragments/frame, "
+              << fragments / (frames * pixels) << " per pixel, "
+              << (covered > 0 ? fragments / covered : 0.0) << " per covered pixel, max " << now.maxCount << " |";
+    for (int b=0; b<OverdrawMeter::BUCKETS; b++) {
+        unsigned long long n = now.pixels[b] - since.pixels[b];
+        if (n) std::cout << " " << b << (b == OverdrawMeter::BUCKETS - 1 ? "+x " : "x ")
+                         << std::fixed << std::setprecision(1) << 100.0 * n / (frames * pixels) << "%"
+                         << std::defaultfloat << std::setprecision(6);
+    }
+    std::cout << std::endl;
+}
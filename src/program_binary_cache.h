@@ -0,0 +1,134 @@
+#pragma once
+// On-disk cache of linked program binaries (GL_ARB_get_program_binary), so a
+// warm start skips compiling and linking GLSL.
+//
+// Entries are keyed by a 64-bit FNV-1a hash of the driver's GL_RENDERER and
+// GL_VERSION strings plus everything that went into the link (final stage
+// sources and attribute bindings), one file per entry. A binary is only ever
+// offered back to the driver that produced it; if it still refuses one (new
+// driver build with the same version string, truncated file) load() fails and
+// the caller compiles as usual, overwriting the stale entry.
+//
+// open() needs a current context. Without the extension, or when the driver
+// reports no binary formats, the cache stays disabled and every build compiles.
+
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+class ProgramBinaryCache {
+public:
+    // load() also runs on the hot-reload thread while the render thread reads these
+    struct Counters { std::atomic<unsigned long> hits{0}, misses{0}; };
+
+    bool open(const char* directory) {
+        enabled = false;
+        if (!GLAD_GL_ARB_get_program_binary) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0) return false;
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            std::cerr << "program cache: cannot create " << directory << ": " << ec.message() << std::endl;
+            return false;
+        }
+        dir = directory;
+        driver = std::string((const char*)glGetString(GL_RENDERER)) + "\n" + (const char*)glGetString(GL_VERSION) + "\n";
+        enabled = true;
+        return true;
+    }
+
+    bool active() const { return enabled; }
+    const Counters& counters() const { return count; }
+
+    std::uint64_t key(const std::string& linkInputs) const {
+        std::uint64_t h = 14695981039346656037ull;
+        for (const std::string* s : { &driver, &linkInputs })
+            for (unsigned char c : *s) { h ^= c; h *= 1099511628211ull; }
+        return h;
+    }
+
+    // Loads the binary stored under k into program (which must have no shaders
+    // attached) and returns whether it linked.
+    bool load(GLuint program, std::uint64_t k) {
+        if (!enabled) return false;
+        std::ifstream in(path(k), std::ios::binary);
+        Header h;
+        std::vector<char> data;
+        if (in.read((char*)&h, sizeof h) && h.magic == MAGIC && h.key == k) {
+            data.resize(h.length);
+            in.read(data.data(), std::streamsize(data.size()));
+        }
+        if (!in || data.empty()) { count.misses++; return false; }
+        glProgramBinary(program, h.format, data.data(), GLsizei(data.size()));
+        GLint ok = 0; glGetProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok) { count.misses++; return false; }
+        count.hits++;
+        return true;
+    }
+
+    // Call before glLinkProgram on programs that are going to be store()d.
+    void prepare(GLuint program) const {
+        if (enabled) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Saves a successfully linked program. Written to a temporary file and
+    // renamed, so a concurrent or interrupted run never sees half an entry.
+    void store(GLuint program, std::uint64_t k) const {
+        if (!enabled) return;
+        GLint length = 0; glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<char> data(length);
+        Header h = { MAGIC, 0, k, 0 };
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &h.format, data.data());
+        if (written <= 0) return;
+        h.length = std::uint32_t(written);
+        std::string p = path(k), tmp = p + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write((const char*)&h, sizeof h);
+            out.write(data.data(), written);
+            if (!out) { std::remove(tmp.c_str()); return; }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, p, ec);
+        if (ec) std::remove(tmp.c_str());
+    }
+
+private:
+    static const std::uint32_t MAGIC = 0x31425047;   // "GPB1"
+    struct Header { std::uint32_t magic; GLenum format; std::uint64_t key; std::uint32_t length; };
+
+    std::string path(std::uint64_t k) const {
+        char name[32];
+        std::snprintf(name, sizeof name, "%016llx.bin", (unsigned long long)k);
+        return dir + "/" + name;
+    }
+
+    bool enabled = false;
+    std::string dir, driver;
+    Counters count;
+};
+
+// --startup-time report: process start to the first finished frame, and how
+// much of it went into building programs.
+inline void printStartupTime(std::chrono::steady_clock::time_point processStart, double buildSeconds,
+                             const ProgramBinaryCache& cache) {
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - processStart).count();
+    std::cout << "first frame after " << 1e3 * total << " ms, programs built in " << 1e3 * buildSeconds << " ms (";
+    if (cache.active())
+        std::cout << "binary cache: " << cache.counters().hits << " loaded, " << cache.counters().misses << " compiled)";
+    else
+        std::cout << "binary cache off)";
+    std::cout << std::endl;
+}
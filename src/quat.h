@@ -0,0 +1,68 @@
+#pragma once
+// Unit quaternions for incremental orientation updates.
+//
+// quatMul(a, b) applies b first, then a (the usual Hamilton product). Matrices
+// produced here follow the mat4.h row-vector layout, so for composeQuatTRS the
+// rotation of quatMul(a, b) is R(b) * R(a). With that, cube.cpp's old Euler
+// S * Rx(rotX) * Ry(rotY) * T is the orientation quatMul(qy(rotY), qx(rotX)).
+
+#include <cmath>
+
+struct Quat { float w = 1.0f, x = 0.0f, y = 0.0f, z = 0.0f; };
+
+// Rotation by angle (radians) about a unit axis; this is the only place trig is needed.
+inline Quat quatAxisAngle(float ax, float ay, float az, float angle) {
+    float h = 0.5f * angle, s = std::sin(h);
+    return { std::cos(h), ax*s, ay*s, az*s };
+}
+
+inline Quat quatMul(const Quat& a, const Quat& b) {
+    return { a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+             a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+             a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+             a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w };
+}
+
+inline float quatDot(const Quat& a, const Quat& b) { return a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z; }
+
+// Pulls a quaternion that has drifted slightly off unit length back onto it with
+// one Newton step of 1/sqrt(n) around n = 1: no sqrt or divide. Enough after each
+// incremental multiply, where the drift is a few ulps.
+inline Quat quatRenormalize(const Quat& q) {
+    float k = 0.5f * (3.0f - quatDot(q, q));
+    return { q.w*k, q.x*k, q.y*k, q.z*k };
+}
+
+inline Quat quatNormalize(const Quat& q) {
+    float k = 1.0f / std::sqrt(quatDot(q, q));
+    return { q.w*k, q.x*k, q.y*k, q.z*k };
+}
+
+// Constant angular velocity interpolation along the shorter arc.
+inline Quat quatSlerp(const Quat& a, Quat b, float t) {
+    float d = quatDot(a, b);
+    if (d < 0.0f) { d = -d; b = { -b.w, -b.x, -b.y, -b.z }; }
+    float ka, kb;
+    if (d > 0.9995f) {
+        // nearly parallel: sin(theta) underflows, a normalized lerp is exact enough
+        ka = 1.0f - t; kb = t;
+        Quat r = { ka*a.w + kb*b.w, ka*a.x + kb*b.x, ka*a.y + kb*b.y, ka*a.z + kb*b.z };
+        return quatNormalize(r);
+    }
+    float theta = std::acos(d), inv = 1.0f / std::sin(theta);
+    ka = std::sin((1.0f - t) * theta) * inv;
+    kb = std::sin(t * theta) * inv;
+    return { ka*a.w + kb*b.w, ka*a.x + kb*b.x, ka*a.y + kb*b.y, ka*a.z + kb*b.z };
+}
+
+// m = S(s) * R(q) * T(tx,ty,tz) in closed form, the quaternion counterpart of composeTRS.
+inline void composeQuatTRS(float* m, float s, const Quat& q, float tx, float ty, float tz) {
+    float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+    float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+    float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+    float s2 = 2.0f * s;
+    m[0]  = s - s2*(yy+zz); m[1]  = s2*(xy+wz);     m[2]  = s2*(xz-wy);     m[3]  = 0.0f;
+    m[4]  = s2*(xy-wz);     m[5]  = s - s2*(xx+zz); m[6]  = s2*(yz+wx);     m[7]  = 0.0f;
+    m[8]  = s2*(xz+wy);     m[9]  = s2*(yz-wx);     m[10] = s - s2*(xx+yy); m[11] = 0.0f;
+    m[12] = tx;             m[13] = ty;             m[14] = tz;             m[15] = 1.0f;
+}
@@ -0,0 +1,78 @@
+#pragma once
+// Deferred draw submission: each draw is recorded as a 64-bit sort key plus a
+// 32-bit payload (an index into the caller's per-draw data), sorted once per
+// frame and then submitted in key order.
+//
+// Key layout, most significant first, so sorting groups draws by what is most
+// expensive to switch:
+//
+//   63..60  window      which context submits it
+//   59..56  layer       painter's order; draws that may overlap need different layers
+//   55..48  program     index into the caller's program table
+//   47..32  mesh        index into the caller's mesh table
+//   31..28  mode        GL primitive mode (GL_POINTS .. GL_TRIANGLE_FAN fit in 4 bits)
+//   27..12  depth       16-bit unsigned depth, front to back within a layer
+//   11..0   unused
+//
+// The sort is an LSD radix sort over 8-bit digits. It is stable, so draws with
+// equal keys keep their recording order, and digits on which every key agrees
+// (most of them, usually) cost one pass over the histogram and are skipped.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct RenderCommand {
+    std::uint64_t key;
+    std::uint32_t payload;
+};
+
+inline std::uint64_t renderKey(unsigned window, unsigned layer, unsigned program, unsigned mesh,
+                               unsigned mode, float depth = 0.0f) {
+    float d = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    return (std::uint64_t(window & 0xF) << 60) | (std::uint64_t(layer & 0xF) << 56) |
+           (std::uint64_t(program & 0xFF) << 48) | (std::uint64_t(mesh & 0xFFFF) << 32) |
+           (std::uint64_t(mode & 0xF) << 28) | (std::uint64_t(d * 65535.0f + 0.5f) << 12);
+}
+
+inline unsigned keyWindow(std::uint64_t k)  { return unsigned(k >> 60) & 0xF; }
+inline unsigned keyLayer(std::uint64_t k)   { return unsigned(k >> 56) & 0xF; }
+inline unsigned keyProgram(std::uint64_t k) { return unsigned(k >> 48) & 0xFF; }
+inline unsigned keyMesh(std::uint64_t k)    { return unsigned(k >> 32) & 0xFFFF; }
+inline unsigned keyMode(std::uint64_t k)    { return unsigned(k >> 28) & 0xF; }
+
+class RenderQueue {
+public:
+    void clear() { cmds.clear(); }
+    void push(std::uint64_t key, std::uint32_t payload) { cmds.push_back({ key, payload }); }
+
+    std::size_t size() const { return cmds.size(); }
+    const RenderCommand* begin() const { return cmds.data(); }
+    const RenderCommand* end() const { return cmds.data() + cmds.size(); }
+
+    void sort() {
+        std::size_t n = cmds.size();
+        if (n < 2) return;
+        scratch.resize(n);
+        // all eight histograms in one pass over the keys
+        std::size_t hist[8][256] = {};
+        for (const RenderCommand& c : cmds)
+            for (int d=0; d<8; d++) hist[d][(c.key >> (d*8)) & 0xFF]++;
+
+        RenderCommand* src = cmds.data();
+        RenderCommand* dst = scratch.data();
+        for (int d=0; d<8; d++) {
+            std::size_t* h = hist[d];
+            if (h[(src[0].key >> (d*8)) & 0xFF] == n) continue;   // every key has this digit
+            std::size_t sum = 0;
+            for (int b=0; b<256; b++) { std::size_t c = h[b]; h[b] = sum; sum += c; }
+            for (std::size_t i=0; i<n; i++) dst[h[(src[i].key >> (d*8)) & 0xFF]++] = src[i];
+            std::swap(src, dst);
+        }
+        if (src != cmds.data()) cmds.swap(scratch);
+    }
+
+private:
+    std::vector<RenderCommand> cmds, scratch;
+};
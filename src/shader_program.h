@@ -0,0 +1,392 @@
+#pragma once
+// A linked GLSL program plus what reflection found in it.
+//
+// build() compiles, links and then enumerates the active uniforms, attributes
+// and uniform blocks once, into hashed tables. Callers resolve every name they
+// need at load time into a typed handle (Uniform<GL_FLOAT_VEC2> and friends);
+// a name that is not active, or whose GLSL type differs from the handle's, is
+// reported right there instead of silently turning into location -1. Per-frame
+// code only ever passes handles, which go through the program's UniformCache.
+//
+// With a ProgramBinaryCache attached, build() first tries the linked binary
+// saved by an earlier run and only compiles when there is none (or the driver
+// rejects it); reflection runs either way.
+//
+// build() is submit() followed by wait(). Splitting them lets a caller hand
+// every program to the driver up front and only ask for link results when a
+// program is first needed, instead of stalling on each compile in turn.
+//
+// A ShaderProgram owns its GL objects and is move-only. What it is built with
+// (defines, attribute and block bindings, binary cache) is a ShaderConfig,
+// which copies freely: one configuration can seed any number of programs.
+//
+// ShaderPermutations builds variants of one shader pair from injected #defines,
+// keyed by a feature bit mask.
+
+#include <glad/glad.h>
+#include "program_binary_cache.h"
+#include "uniform_cache.h"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Reads a whole shader source file; false (after saying why) if it cannot.
+inline bool loadShaderSource(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) { std::cerr << "cannot read shader " << path << std::endl; return false; }
+    std::ostringstream s;
+    s << in.rdbuf();
+    out = s.str();
+    return true;
+}
+
+template <GLenum Type> struct Uniform { GLint location = -1; };
+typedef Uniform<GL_FLOAT>      UniformFloat;
+typedef Uniform<GL_INT>        UniformInt;
+typedef Uniform<GL_FLOAT_VEC2> UniformVec2;
+typedef Uniform<GL_FLOAT_VEC3> UniformVec3;
+typedef Uniform<GL_FLOAT_MAT4> UniformMat4;
+
+// Everything a program is built with; the setters take effect at the next build().
+struct ShaderConfig {
+    std::string defines, vertexPrelude;
+    std::vector<std::pair<GLuint, std::string>> attribBindings, blockBindings;
+    ProgramBinaryCache* binaryCache = nullptr;
+
+    // Fixes an attribute's location.
+    void bindAttribute(GLuint index, const char* name) { attribBindings.push_back({ index, name }); }
+
+    // Adds "#define <name>" right after the #version line of both stages.
+    void define(const std::string& macro) { defines += "#define " + macro + "\n"; }
+
+    // Adds code after the #defines of the vertex stage only: functions several
+    // vertex shaders share, kept in a file of their own.
+    void prependToVertex(const std::string& code) { vertexPrelude += code; }
+
+    // Assigns a uniform block to a buffer binding point.
+    void bindBlock(const char* blockName, GLuint binding) { blockBindings.push_back({ binding, blockName }); }
+
+    // Load / save linked binaries through cache (nullptr: always compile).
+    void useBinaryCache(ProgramBinaryCache* cache) { binaryCache = cache; }
+};
+
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    explicit ShaderProgram(ShaderConfig c) : config(std::move(c)) {}
+
+    // GL names have one owner: moving hands them over, copying is not allowed.
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    ShaderProgram(ShaderProgram&& o) noexcept { take(o); }
+    ShaderProgram& operator=(ShaderProgram&& o) noexcept {
+        if (this != &o) { destroy(); take(o); }
+        return *this;
+    }
+
+    // Set up this program's own configuration; see ShaderConfig.
+    void bindAttribute(GLuint index, const char* name) { config.bindAttribute(index, name); }
+    void define(const std::string& macro) { config.define(macro); }
+    void prependToVertex(const std::string& code) { config.prependToVertex(code); }
+    void useBinaryCache(ProgramBinaryCache* cache) { config.useBinaryCache(cache); }
+    const ShaderConfig& configuration() const { return config; }
+
+    // label names the program in error messages. Returns false (after printing
+    // the compile / link log) if the program is unusable.
+    bool build(const char* vsSrc, const char* fsSrc, const char* label) {
+        submit(vsSrc, fsSrc, label);
+        return wait();
+    }
+
+    // Hands both stages and the link to the driver without asking how any of
+    // it went, so the driver can work on it (on its own threads, with
+    // GL_KHR_parallel_shader_compile) while the caller does something else.
+    // The program is usable once wait() has returned true.
+    void submit(const char* vsSrc, const char* fsSrc, const char* label) {
+        destroy();
+        name = label;
+        std::string vsFull = withDefines(vsSrc, config.vertexPrelude), fsFull = withDefines(fsSrc);
+        program = glCreateProgram();
+        ProgramBinaryCache* binaryCache = config.binaryCache;
+        if (binaryCache && binaryCache->active()) {
+            cacheKey = binaryCache->key(linkInputs(vsFull, fsFull));
+            if (binaryCache->load(program, cacheKey)) { state = LINKED; return; }
+            glDeleteProgram(program);   // start over from a clean, never-linked object
+            program = glCreateProgram();
+            binaryCache->prepare(program);
+        }
+        vs = compile(GL_VERTEX_SHADER, vsFull.c_str());
+        fs = compile(GL_FRAGMENT_SHADER, fsFull.c_str());
+        glAttachShader(program, vs); glAttachShader(program, fs);
+        for (const auto& b : config.attribBindings) glBindAttribLocation(program, b.first, b.second.c_str());
+        glLinkProgram(program);
+        state = PENDING;
+    }
+
+    // Whether wait() would return without stalling. Without the extension
+    // there is no way to ask, so a pending program reports false until waited on.
+    bool ready() const {
+        if (state != PENDING) return true;
+        if (!GLAD_GL_KHR_parallel_shader_compile) return false;
+        GLint done = GL_FALSE; glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // Blocks until the submitted link is done, then reflects the program.
+    // Compile logs are only fetched when the link failed.
+    bool wait() {
+        if (state == PENDING) {
+            GLint ok; glGetProgramiv(program, GL_LINK_STATUS, &ok);
+            if (!ok) {
+                checkCompile(vs, "vertex"); checkCompile(fs, "fragment");
+                char buf[512]; glGetProgramInfoLog(program, 512, NULL, buf);
+                std::cerr << name << ": program link error: " << buf << std::endl;
+            }
+            glDeleteShader(vs); glDeleteShader(fs);
+            vs = fs = 0;
+            state = ok ? LINKED : FAILED;
+            if (ok && config.binaryCache && config.binaryCache->active()) config.binaryCache->store(program, cacheKey);
+        }
+        if (state == LINKED) { finish(); state = READY; }
+        return state == READY;
+    }
+
+    void destroy() {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        if (program) glDeleteProgram(program);
+        program = vs = fs = 0;
+        state = EMPTY;
+        uniforms.clear(); attributes.clear(); blocks.clear();
+        cache.reset();
+    }
+
+    GLuint id() const { return program; }
+
+    // true once wait() has seen a successful link
+    bool valid() const { return state == READY; }
+
+    // required = false for uniforms that only some permutations have
+    template <GLenum Type>
+    Uniform<Type> uniform(const char* uniformName, bool required = true) const {
+        Uniform<Type> u;
+        auto it = uniforms.find(uniformName);
+        if (it == uniforms.end()) {
+            if (required) std::cerr << name << ": no active uniform '" << uniformName << "'" << std::endl;
+        } else if (it->second.type != Type) {
+            std::cerr << name << ": uniform '" << uniformName << "' has GL type 0x" << std::hex
+                      << it->second.type << ", handle expects 0x" << Type << std::dec << std::endl;
+        } else {
+            u.location = it->second.location;
+        }
+        return u;
+    }
+
+    GLint attribute(const char* attribName) const {
+        auto it = attributes.find(attribName);
+        if (it != attributes.end()) return it->second.location;
+        std::cerr << name << ": no active attribute '" << attribName << "'" << std::endl;
+        return -1;
+    }
+
+    // Assigns a uniform block to a buffer binding point, now if the program is
+    // built and again after every later build().
+    void bindBlock(const char* blockName, GLuint binding) {
+        config.bindBlock(blockName, binding);
+        if (program) applyBlockBinding(blockName, binding);
+    }
+
+    const std::string& label() const { return name; }
+
+    // Upload through the shadow cache; the program must be current.
+    void set(UniformFloat u, float x)              { cache.set1f(u.location, x); }
+    void set(UniformInt u, GLint x)                { cache.set1i(u.location, x); }
+    void set(UniformVec2 u, float x, float y)      { cache.set2f(u.location, x, y); }
+    void set(UniformVec3 u, const float* v)        { cache.set3fv(u.location, v); }
+    void set(UniformMat4 u, const float* m)        { cache.setMatrix4fv(u.location, m); }
+
+    const UniformCache::Counters& uniformCounters() const { return cache.counters(); }
+
+private:
+    struct Info { GLint location; GLenum type; GLint size; };
+
+    void take(ShaderProgram& o) {
+        program = o.program; vs = o.vs; fs = o.fs;
+        state = o.state; cacheKey = o.cacheKey;
+        name = std::move(o.name);
+        config = std::move(o.config);
+        uniforms = std::move(o.uniforms); attributes = std::move(o.attributes); blocks = std::move(o.blocks);
+        cache = std::move(o.cache);
+        o.program = o.vs = o.fs = 0;
+        o.state = EMPTY;
+        o.uniforms.clear(); o.attributes.clear(); o.blocks.clear();
+        o.cache.reset();
+    }
+
+    std::string withDefines(const char* src, const std::string& prelude = std::string()) const {
+        std::string s(src);
+        std::string inserted = config.defines + prelude;
+        if (inserted.empty()) return s;
+        std::size_t v = s.find("#version");
+        std::size_t at = v == std::string::npos ? 0 : s.find('\n', v);
+        at = at == std::string::npos ? s.size() : at + (v == std::string::npos ? 0 : 1);
+        return s.insert(at, inserted);
+    }
+
+    // everything the linked binary depends on; block bindings are not baked in
+    std::string linkInputs(const std::string& vs, const std::string& fs) const {
+        std::string s = vs + '\0' + fs + '\0';
+        for (const auto& b : config.attribBindings) s += std::to_string(b.first) + "=" + b.second + "\n";
+        return s;
+    }
+
+    // loading a binary resets uniforms and block bindings just like linking
+    void finish() {
+        reflect();
+        for (const auto& b : config.blockBindings) applyBlockBinding(b.second.c_str(), b.first);
+    }
+
+    void applyBlockBinding(const char* blockName, GLuint binding) const {
+        auto it = blocks.find(blockName);
+        if (it == blocks.end()) {
+            std::cerr << name << ": no active uniform block '" << blockName << "'" << std::endl;
+            return;
+        }
+        glUniformBlockBinding(program, GLuint(it->second.location), binding);
+    }
+
+    static GLuint compile(GLenum type, const char* src) {
+        GLuint s = glCreateShader(type);
+        glShaderSource(s, 1, &src, NULL);
+        glCompileShader(s);
+        return s;
+    }
+
+    void checkCompile(GLuint s, const char* stage) const {
+        GLint ok; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+        if (ok) return;
+        char buf[512]; glGetShaderInfoLog(s, 512, NULL, buf);
+        std::cerr << name << ": " << stage << " shader compile error: " << buf << std::endl;
+    }
+
+    void reflect() {
+        GLint count = 0, maxLen = 0, size = 0;
+        GLenum type = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+        std::vector<char> buf(maxLen > 0 ? maxLen : 1);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i=0; i<count; i++) {
+            glGetActiveUniform(program, GLuint(i), GLsizei(buf.size()), nullptr, &size, &type, buf.data());
+            GLint loc = glGetUniformLocation(program, buf.data());
+            if (loc < 0) continue;   // member of a uniform block
+            uniforms[arrayBase(buf.data())] = { loc, type, size };
+            cache.track(loc, type, size);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLen);
+        buf.assign(maxLen > 0 ? maxLen : 1, 0);
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        for (GLint i=0; i<count; i++) {
+            glGetActiveAttrib(program, GLuint(i), GLsizei(buf.size()), nullptr, &size, &type, buf.data());
+            attributes[arrayBase(buf.data())] = { glGetAttribLocation(program, buf.data()), type, size };
+        }
+
+        if (!GLAD_GL_VERSION_3_1) return;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for (GLint i=0; i<count; i++) {
+            glGetActiveUniformBlockiv(program, GLuint(i), GL_UNIFORM_BLOCK_NAME_LENGTH, &maxLen);
+            buf.assign(maxLen > 0 ? maxLen : 1, 0);
+            glGetActiveUniformBlockName(program, GLuint(i), GLsizei(buf.size()), nullptr, buf.data());
+            blocks[buf.data()] = { i, 0, 1 };
+        }
+    }
+
+    // "lights[0]" is reported for arrays; look them up as "lights"
+    static std::string arrayBase(const char* s) {
+        std::string n(s);
+        std::size_t b = n.find('[');
+        return b == std::string::npos ? n : n.substr(0, b);
+    }
+
+    // EMPTY -> PENDING (submitted) or LINKED (binary loaded) -> READY / FAILED
+    enum State { EMPTY, PENDING, LINKED, READY, FAILED };
+
+    GLuint program = 0, vs = 0, fs = 0;
+    State state = EMPTY;
+    std::uint64_t cacheKey = 0;
+    std::string name;
+    ShaderConfig config;
+    std::unordered_map<std::string, Info> uniforms, attributes, blocks;
+    UniformCache cache;
+};
+
+class ShaderPermutations {
+public:
+    // Attribute and block bindings set here are given to every variant.
+    ShaderConfig base;
+
+    // Bit i of a feature mask defines features[i].
+    void init(std::string vsSrc, std::string fsSrc, const char* label, std::vector<std::string> featureNames) {
+        vs = std::move(vsSrc); fs = std::move(fsSrc); name = label;
+        features = std::move(featureNames);
+        variants.clear();
+        variants.resize(std::size_t(1) << features.size());
+        state.assign(variants.size(), NONE);
+    }
+
+    std::size_t count() const { return variants.size(); }
+
+    // Submits every variant not submitted yet for which wanted(mask) holds
+    // (all of them by default), with as many driver compiler threads as it
+    // cares to use; the caller is free to do other loading before the first get().
+    template <class Wanted>
+    void submitAll(Wanted wanted) {
+        if (GLAD_GL_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        for (unsigned mask=0; mask<variants.size(); mask++)
+            if (wanted(mask)) submit(mask);
+    }
+    void submitAll() { submitAll([](unsigned) { return true; }); }
+
+    // Submits the variant if needed and waits for it on first request; later
+    // calls return the cached one.
+    ShaderProgram& get(unsigned mask) {
+        ShaderProgram& p = variants[mask];
+        if (state[mask] == DONE) return p;
+        submit(mask);
+        p.wait();
+        state[mask] = DONE;
+        return p;
+    }
+
+    void destroy() {
+        for (ShaderProgram& p : variants) p.destroy();
+        state.assign(variants.size(), NONE);
+    }
+
+private:
+    enum State : unsigned char { NONE, SUBMITTED, DONE };
+
+    void submit(unsigned mask) {
+        if (state[mask] != NONE) return;
+        state[mask] = SUBMITTED;
+        ShaderProgram& p = variants[mask];
+        p = ShaderProgram(base);
+        std::string label = name + "[";
+        for (std::size_t i=0; i<features.size(); i++) {
+            if (!(mask & (1u << i))) continue;
+            p.define(features[i]);
+            label += (label.back() == '[' ? "" : " ") + features[i];
+        }
+        p.submit(vs.c_str(), fs.c_str(), (label + "]").c_str());
+    }
+
+    std::string vs, fs, name;
+    std::vector<std::string> features;
+    std::vector<ShaderProgram> variants;
+    std::vector<State> state;
+};
@@ -0,0 +1,195 @@
+#pragma once
+// Hot reload of shader programs whose sources live in files.
+//
+// A background thread blocks on inotify for the shader directory. When a
+// watched file is written, or renamed over (the way most editors save), every
+// program that reads it is rebuilt on that thread, in a hidden context sharing
+// objects with the render contexts. Only programs that linked are handed back,
+// with a fence behind them: the render thread swaps them in from poll(),
+// between frames, once the fence has signalled. Neither thread waits for the
+// other, so a compile never stalls a frame, and a broken edit leaves the
+// running program alone (its log goes to std::cerr as usual).
+//
+// The rebuild and swap callbacks belong to the caller. rebuild() runs on the
+// watcher thread with its context current and builds into a staging program;
+// swap() runs on the render thread and exchanges the staged program with the
+// live one, re-resolving handles and re-setting any uniforms that are not
+// uploaded every frame (a newly linked program starts with all of them zero).
+// The program swapped out may still be bound in other contexts; delete it only
+// once each of them has bound the new one.
+//
+// Linux only (inotify); elsewhere start() says so and returns false.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+class ShaderReloader {
+public:
+    struct Program {
+        std::string label;
+        std::vector<std::string> files;    // names inside the watched directory
+        std::function<bool()> rebuild;     // watcher thread; false keeps the live program
+        std::function<void()> swap;        // render thread
+    };
+
+    ~ShaderReloader() { stop(); }
+
+    // Register everything before start().
+    void add(Program p) { programs.push_back(std::move(p)); }
+
+    // Call from the thread that created shareWith (GLFW creates windows on the
+    // main thread only). Window hints other than GLFW_VISIBLE are left as the
+    // caller set them, so the hidden context matches the render contexts.
+    bool start(const char* directory, GLFWwindow* shareWith) {
+#ifdef __linux__
+        notifyFd = inotify_init1(IN_CLOEXEC);
+        if (notifyFd < 0 || inotify_add_watch(notifyFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            std::cerr << "shader reload: cannot watch " << directory << std::endl;
+            stop();
+            return false;
+        }
+        if (pipe(wakeFds) != 0) { stop(); return false; }
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context = glfwCreateWindow(1, 1, "shader reload", nullptr, shareWith);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!context) { stop(); return false; }
+        swapReady.assign(programs.size(), 0);
+        built.assign(programs.size(), nullptr);
+        changedAt.resize(programs.size());
+        worker = std::thread(&ShaderReloader::run, this);
+        return true;
+#else
+        (void)directory; (void)shareWith;
+        std::cerr << "shader reload: needs inotify (Linux)" << std::endl;
+        return false;
+#endif
+    }
+
+    // Render thread, once per frame, with any context current. Swaps in what
+    // finished rebuilding since the last call; returns how many programs.
+    int poll() {
+        if (!pending.load(std::memory_order_acquire)) return 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        bool waiting = false;
+        int swapped = 0;
+        for (std::size_t i=0; i<programs.size(); i++) {
+            if (!swapReady[i]) continue;
+            // a signalled fence makes the program safe to use from every context
+            if (built[i]) {
+                if (glClientWaitSync(built[i], 0, 0) == GL_TIMEOUT_EXPIRED) { waiting = true; continue; }
+                glDeleteSync(built[i]);
+                built[i] = nullptr;
+            }
+            swapReady[i] = 0;
+            programs[i].swap();
+            swapped++;
+            std::cout << "shader reload: " << programs[i].label << " swapped in "
+                      << 1e3 * std::chrono::duration<double>(Clock::now() - changedAt[i]).count()
+                      << " ms after the edit" << std::endl;
+        }
+        pending.store(waiting, std::memory_order_relaxed);
+        return swapped;
+    }
+
+    // Must run before glfwTerminate(); the destructor only covers early exits.
+    void stop() {
+#ifdef __linux__
+        if (worker.joinable()) {
+            char c = 0;
+            if (write(wakeFds[1], &c, 1) != 1) std::cerr << "shader reload: cannot wake watcher" << std::endl;
+            worker.join();
+        }
+        for (GLsync& f : built) if (f) glDeleteSync(f);
+        built.clear();
+        if (context) glfwDestroyWindow(context);
+        context = nullptr;
+        for (int* fd : { &notifyFd, &wakeFds[0], &wakeFds[1] }) {
+            if (*fd >= 0) close(*fd);
+            *fd = -1;
+        }
+#endif
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+#ifdef __linux__
+    void run() {
+        glfwMakeContextCurrent(context);
+        alignas(inotify_event) char buf[4096];
+        pollfd fds[2] = { { notifyFd, POLLIN, 0 }, { wakeFds[0], POLLIN, 0 } };
+        std::vector<char> dirty(programs.size(), 0);
+        std::vector<Clock::time_point> dirtyAt(programs.size());
+        bool deferred = false;
+        for (;;) {
+            // a program whose last rebuild has not been swapped in yet is
+            // retried shortly, instead of rebuilding over the staged one
+            if (::poll(fds, 2, deferred ? 2 : -1) < 0) continue;   // EINTR
+            if (fds[1].revents) break;
+            if (fds[0].revents) {
+                ssize_t n = read(notifyFd, buf, sizeof buf);
+                Clock::time_point now = Clock::now();
+                // one save can be several events; each program is rebuilt once
+                for (char* p = buf; n > 0 && p < buf + n; ) {
+                    const inotify_event* e = (const inotify_event*)p;
+                    p += sizeof(inotify_event) + e->len;
+                    if (!e->len) continue;
+                    for (std::size_t i=0; i<programs.size(); i++) {
+                        const std::vector<std::string>& f = programs[i].files;
+                        if (std::find(f.begin(), f.end(), e->name) == f.end()) continue;
+                        if (!dirty[i]) dirtyAt[i] = now;
+                        dirty[i] = 1;
+                    }
+                }
+            }
+            deferred = false;
+            for (std::size_t i=0; i<programs.size(); i++) {
+                if (!dirty[i]) continue;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (swapReady[i]) { deferred = true; continue; }
+                }
+                dirty[i] = 0;
+                if (!programs[i].rebuild()) continue;
+                // glFinish() would do, but can queue up behind the render
+                // contexts' work; the fence is only checked, never waited on
+                GLsync f = nullptr;
+                if (GLAD_GL_VERSION_3_2) { f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); glFlush(); }
+                else glFinish();
+                std::lock_guard<std::mutex> lock(mutex);
+                swapReady[i] = 1;
+                built[i] = f;
+                changedAt[i] = dirtyAt[i];
+                pending.store(true, std::memory_order_release);
+            }
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    int notifyFd = -1;
+    int wakeFds[2] = { -1, -1 };
+#endif
+
+    std::vector<Program> programs;
+    GLFWwindow* context = nullptr;
+    std::thread worker;
+    std::mutex mutex;
+    std::atomic<bool> pending{ false };
+    std::vector<char> swapReady;                 // guarded by mutex
+    std::vector<GLsync> built;                   // guarded by mutex
+    std::vector<Clock::time_point> changedAt;    // guarded by mutex
+};
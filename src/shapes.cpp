@@ -1,8 +1,22 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "shader_program.h"
+#include "shader_reloader.h"
+#include "gl_call_counter.h"
+#include "mesh_opt.h"
+#include "fragment_counter.h"
+#include "overdraw_meter.h"
 
 const float PI = 3.14159265358979323846f;
 const int MAIN_W = 700, MAIN_H = 700;
@@ -17,74 +31,173 @@ float subBgR = 0.2f, subBgG = 0.2f, subBgB = 0.5f;
 float w2_R = 1.0f, w2_G = 1.0f, w2_B = 1.0f;
 
 // ----------------- Shaders -----------------
-const char* vertexShaderSrc = R"(
-#version 130
-in vec2 aPos;
-in vec3 aColor;
-out vec3 vColor;
-uniform vec2 offset;
-uniform float scale;
-uniform float angle;
-uniform int useOverride;
-uniform vec3 overrideColor;
-
-void main() {
-    float c = cos(angle);
-    float s = sin(angle);
-    mat2 R = mat2(c, -s, s, c);
-    vec2 p = R * (aPos * scale) + offset;
-    gl_Position = vec4(p, 0.0, 1.0);
-    if (useOverride == 1) vColor = overrideColor;
-    else vColor = aColor;
-}
-)";
-
-const char* fragmentShaderSrc = R"(
-#version 130
-in vec3 vColor;
-out vec4 FragColor;
-void main() { FragColor = vec4(vColor, 1.0); }
-)";
+// Sources live in shaders/ (shapes.vert / .frag, or shapes_ubo.* on GL 3.2+)
+// and are read at startup; with --hot-reload, edits to them are picked up
+// while running.
+const char* SHADER_DIR = "shaders";
 
 // ----------------- Helper Structures -----------------
-struct Mesh { GLuint VBO=0; GLsizei vertexCount=0; };
-
-static GLuint compileProgram(const char* vsSrc, const char* fsSrc) {
-    auto compile = [](GLenum type, const char* src)->GLuint {
-        GLuint s = glCreateShader(type);
-        glShaderSource(s, 1, &src, NULL);
-        glCompileShader(s);
-        GLint ok; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
-        if (!ok) {
-            char buf[512]; glGetShaderInfoLog(s, 512, NULL, buf);
-            std::cerr << "Shader compile error: " << buf << std::endl;
+// Shader permutations of the shapes program (see shapes.vert); a draw's
+// variant is the mask of the features it needs.
+enum ShapeFeature {
+    FEATURE_OVERRIDE_COLOR = 1, FEATURE_ROTATION = 2, FEATURE_PROCEDURAL = 4, FEATURE_SDF = 8, FEATURE_INSTANCED = 16
+};
+
+// Vertex formats a mesh can use; each one gets its own VAO per context.
+enum class VertexLayout {
+    PosColor,   // x, y, r, g, b interleaved
+    None        // procedural: the vertex shader builds vertices from gl_VertexID
+};
+
+// A mesh is a range of vertices inside the shared MeshPool vertex buffer plus
+// its indices inside the pool's index buffer. The indices count from first
+// when the pool draws with a base vertex, from the start of the buffer otherwise.
+// A procedural or SDF mesh has neither: it is vertexCount vertices generated
+// from the shape and shapeColor uniforms (see shapes.vert).
+struct Mesh {
+    GLint first=0; GLsizei vertexCount=0; VertexLayout layout=VertexLayout::PosColor;
+    GLsizei indexCount=0; GLenum indexType=GL_UNSIGNED_INT; GLintptr indexOffset=0;
+    unsigned features = 0;                     // FEATURE_PROCEDURAL or FEATURE_SDF if generated
+    float shape[3] = {}, shapeColor[3] = {};   // radii x, y and segments (0: the triangle); color
+};
+
+// All generated geometry lives in one vertex buffer (x, y, r, g, b per vertex)
+// and one index buffer, so a frame binds a single pair of buffers and draws
+// differ only in offsets and counts.
+struct MeshPool {
+    GLuint VBO = 0, EBO = 0;
+    // zeros for attribute 0 of procedural draws (see enableZeroAttribute()), one
+    // per vertex of the largest procedural mesh; 0 if there are none
+    GLuint zerosVBO = 0;
+    GLsizei proceduralVertices = 0;   // counted by makeProceduralMesh()
+    bool baseVertex = false;   // glDrawElementsBaseVertex (GL 3.2); set before makeMesh()
+    bool report = false;       // print each mesh's upload size
+    std::vector<float> staging;   // accumulated by makeMesh(), released by uploadMeshPool()
+    std::vector<unsigned char> indexStaging;
+};
+
+// For a VAO whose vertices the shaders generate from gl_VertexID. A
+// compatibility context (the windows ask for GL 2.1) only transfers a vertex
+// when attribute 0 is enabled; Mesa draws without, other drivers need not. So
+// it is enabled on the pool's zeros, which nothing reads: aPos, bound to 0, is
+// compiled out of those variants.
+static void enableZeroAttribute(GlState& state, const MeshPool& pool) {
+    state.bindBuffer(GL_ARRAY_BUFFER, pool.zerosVBO);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(0);
+}
+
+// VAOs are container objects and are not shared between contexts, even within a
+// share group, so the three windows each need their own. The cache builds one per
+// (context, layout) the first time it is asked for and afterwards only hands it back.
+struct VaoCache {
+    struct Entry { GLFWwindow* context; VertexLayout layout; GLuint vao; };
+    std::vector<Entry> entries;
+
+    // Call with ctx current and state its GlState; the layout's attributes
+    // read from pool's buffers.
+    GLuint get(GlState& state, GLFWwindow* ctx, VertexLayout layout, const MeshPool& pool) {
+        for (const Entry& e : entries)
+            if (e.context == ctx && e.layout == layout) return e.vao;
+        GLuint vao;
+        glGenVertexArrays(1, &vao);
+        state.bindVertexArray(vao);
+        entries.push_back({ ctx, layout, vao });
+        if (layout == VertexLayout::None) {   // no indices either
+            enableZeroAttribute(state, pool);
+            return vao;
         }
-        return s;
-    };
-    GLuint vs = compile(GL_VERTEX_SHADER, vsSrc);
-    GLuint fs = compile(GL_FRAGMENT_SHADER, fsSrc);
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs); glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char buf[512]; glGetProgramInfoLog(prog, 512, NULL, buf);
-        std::cerr << "Program link error: " << buf << std::endl;
+        state.bindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(2*sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);   // recorded in the VAO too
+        return vao;
     }
-    glDeleteShader(vs); glDeleteShader(fs);
-    return prog;
-}
 
-static Mesh makeMesh(const std::vector<float>& data) {
+    // Deletes ctx's VAOs; ctx must be current.
+    void release(GLFWwindow* ctx) {
+        for (std::size_t i=0; i<entries.size(); ) {
+            if (entries[i].context != ctx) { i++; continue; }
+            glDeleteVertexArrays(1, &entries[i].vao);
+            entries[i] = entries.back();
+            entries.pop_back();
+        }
+    }
+};
+
+// Welds the builder's duplicate vertices into an indexed mesh with the
+// narrowest index type that reaches them; with base vertex draws that depends
+// only on the mesh's own size, not on where it lands in the pool. Triangle
+// order is kept as built, since overlapping shapes (the zebra's stacked
+// quads) depend on it.
+static Mesh makeMesh(MeshPool& pool, const char* name, std::vector<float> data) {
     Mesh m;
-    glGenBuffers(1, &m.VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
-    glBufferData(GL_ARRAY_BUFFER, data.size()*sizeof(float), data.data(), GL_STATIC_DRAW);
+    std::size_t unindexedBytes = data.size()*sizeof(float);
+    std::vector<std::uint32_t> indices = weldVertices(data, 5);
+    m.first = static_cast<GLint>(pool.staging.size()/5);
     m.vertexCount = static_cast<GLsizei>(data.size()/5);
+    m.indexCount = static_cast<GLsizei>(indices.size());
+    std::uint32_t bias = pool.baseVertex ? 0 : std::uint32_t(m.first);
+    int bytes = indexBytes(std::uint32_t(m.vertexCount - 1) + bias);
+    m.indexType = bytes == 1 ? GL_UNSIGNED_BYTE : bytes == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m.indexOffset = static_cast<GLintptr>(appendIndices(pool.indexStaging, indices, bytes, bias));
+    pool.staging.insert(pool.staging.end(), data.begin(), data.end());
+    if (pool.report)
+        std::cout << "mesh " << name << ": " << m.indexCount << " vertices welded to " << m.vertexCount << ", "
+                  << data.size()*sizeof(float) << " + " << std::size_t(m.indexCount) * bytes << " bytes ("
+                  << bytes * 8 << "-bit indices), " << unindexedBytes << " unindexed" << std::endl;
     return m;
 }
 
+// --procedural: a fan of `segments` rim vertices around an ellipse with radii
+// rx, ry (centre, rim, then the first rim vertex again), or with no segments
+// the triangle. With FEATURE_SDF instead, the ellipse as a four-vertex fan
+// around it. Nothing goes into the pool.
+static Mesh makeProceduralMesh(MeshPool& pool, const char* name, unsigned features, int segments,
+                               float rx, float ry, float r, float g, float b) {
+    Mesh m;
+    m.layout = VertexLayout::None;
+    m.features = features;
+    m.vertexCount = m.indexCount = (features & FEATURE_SDF) ? 4 : segments ? segments + 2 : 3;
+    pool.proceduralVertices = std::max(pool.proceduralVertices, m.vertexCount);
+    float shape[3] = { rx, ry, float(segments) }, color[3] = { r, g, b };
+    std::memcpy(m.shape, shape, sizeof shape);
+    std::memcpy(m.shapeColor, color, sizeof color);
+    if (pool.report)
+        std::cout << "mesh " << name << ": " << m.vertexCount << " vertices, "
+                  << ((features & FEATURE_SDF) ? "SDF quad" : "procedural") << ", 0 bytes" << std::endl;
+    return m;
+}
+
+static void uploadMeshPool(GlState& state, MeshPool& pool) {
+    glGenBuffers(1, &pool.VBO);
+    state.bindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    glBufferData(GL_ARRAY_BUFFER, pool.staging.size()*sizeof(float), pool.staging.data(), GL_STATIC_DRAW);
+    // the element binding belongs to the VAO; upload through the default one
+    state.bindVertexArray(0);
+    glGenBuffers(1, &pool.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, pool.indexStaging.size(), pool.indexStaging.data(), GL_STATIC_DRAW);
+    if (pool.proceduralVertices > 0) {
+        std::vector<float> zeros(pool.proceduralVertices);
+        glGenBuffers(1, &pool.zerosVBO);
+        state.bindBuffer(GL_ARRAY_BUFFER, pool.zerosVBO);
+        glBufferData(GL_ARRAY_BUFFER, zeros.size()*sizeof(float), zeros.data(), GL_STATIC_DRAW);
+    }
+    if (pool.report)
+        std::cout << "mesh pool: " << pool.staging.size()*sizeof(float) << " vertex + "
+                  << pool.indexStaging.size() << " index bytes uploaded" << std::endl;
+    std::vector<float>().swap(pool.staging);
+    std::vector<unsigned char>().swap(pool.indexStaging);
+}
+
 // ----------------- Shape Builders -----------------
+// Concentric squares alternating white and black from the outside in, built
+// as non-overlapping rings around a solid centre square so every pixel is
+// shaded once. Neighbouring rings share their edges exactly, which gives the
+// same image as stacking full squares largest first.
 static void buildZebra(std::vector<float>& out, int layers=8) {
     out.clear();
     float max = 0.9f;
@@ -92,11 +205,22 @@ static void buildZebra(std::vector<float>& out, int layers=8) {
     for (int i=0; i<layers; i++){
         float s = max - i*step;
         float c = (i % 2 == 0) ? 1.0f : 0.0f;
-        float quad[] = {
-            -s, -s, c, c, c,   s, -s, c, c, c,   s,  s, c, c, c,
-            -s, -s, c, c, c,   s,  s, c, c, c,  -s,  s, c, c, c
-        };
-        out.insert(out.end(), quad, quad+30);
+        if (i == layers-1) {
+            float quad[] = {
+                -s, -s, c, c, c,   s, -s, c, c, c,   s,  s, c, c, c,
+                -s, -s, c, c, c,   s,  s, c, c, c,  -s,  s, c, c, c
+            };
+            out.insert(out.end(), quad, quad+30);
+            break;
+        }
+        float t = max - (i+1)*step;   // the next square in
+        float outer[4][2] = { {-s,-s}, {s,-s}, {s,s}, {-s,s} };
+        float inner[4][2] = { {-t,-t}, {t,-t}, {t,t}, {-t,t} };
+        // one trapezoid per side, two triangles each
+        for (int k=0; k<4; k++) {
+            const float* corners[6] = { outer[k], outer[(k+1)%4], inner[(k+1)%4], outer[k], inner[(k+1)%4], inner[k] };
+            for (const float* v : corners) out.insert(out.end(), { v[0], v[1], c, c, c });
+        }
     }
 }
 
@@ -104,7 +228,7 @@ static void buildEllipse(std::vector<float>& out, int seg=64, float rx=0.5f, flo
     out.clear();
     out.insert(out.end(), {0.0f, 0.0f, 1.0f, 0.5f, 0.0f});
     for (int i=0; i<=seg; i++){
-        float t = 2.0f * PI * i / seg;
+        float t = 2.0f * PI * (i % seg) / seg;   // the closing vertex is exactly the first
         out.insert(out.end(), {rx * cosf(t), ry * sinf(t), 1.0f, 0.5f, 0.0f});
     }
 }
@@ -113,7 +237,7 @@ static void buildCircle(std::vector<float>& out, int seg=64, float r=1.0f) {
     out.clear();
     out.insert(out.end(), {0.0f, 0.0f, 1.0f, 1.0f, 1.0f});
     for (int i=0; i<=seg; i++){
-        float t = 2.0f * PI * i / seg;
+        float t = 2.0f * PI * (i % seg) / seg;   // the closing vertex is exactly the first
         out.insert(out.end(), {r * cosf(t), r * sinf(t), 1.0f, 1.0f, 1.0f});
     }
 }
@@ -128,11 +252,97 @@ static void buildTriangle(std::vector<float>& out) {
 }
 
 // ----------------- Globals -----------------
-GLuint program = 0;
-GLint locOffset, locScale, locAngle, locUseOverride, locOverrideColor;
-Mesh zebraMesh, ellipseMesh, circleMesh, triangleMesh;
+// Sort key fields index these tables; the program field is a ShapeFeature mask,
+// the mesh field MeshId * LOD_COUNT + level of detail.
+enum WindowId { WIN_MAIN, WIN_SUB, WIN_2, WIN_COUNT };
+enum MeshId { MESH_ZEBRA, MESH_ELLIPSE, MESH_CIRCLE, MESH_TRIANGLE, MESH_COUNT };
+
+// The ellipse and circle are built at each of these segment counts, and every
+// draw uses the coarsest one whose rim stays within lodPixelError pixels of the
+// true curve at the size it appears on screen. 64 is what they always used.
+const int LOD_SEGMENTS[] = { 8, 16, 32, 64, 128, 256 };
+const int LOD_COUNT = sizeof(LOD_SEGMENTS) / sizeof(LOD_SEGMENTS[0]);
+const int LOD_FIXED = 3;
+float lodPixelError = 0.5f;   // --lod-error; 0 always draws LOD_FIXED
+// largest radius of each mesh as built, in mesh units; 0 for meshes without LODs
+const float MESH_RADIUS[MESH_COUNT] = { 0.0f, 0.5f, 1.0f, 0.0f };
+const unsigned SHAPE_VARIANTS = 32;
+// --procedural: the ellipse, circle and triangle have no vertex data and are
+// generated in the vertex shader; the zebra stays a vertex buffer mesh.
+// --sdf: the ellipse and circle are single quads shaded from their distance
+// to the rim, antialiased; they take precedence over --procedural.
+bool procedural = false, sdf = false;
+int circleBenchCount = 0;   // --circle-bench N
+ShaderPermutations shapePrograms;
+ShaderPermutations stagedShapePrograms;    // --hot-reload builds into this, then swaps
+// Programs swapped out by a reload, with the windows that may still have one
+// of them bound; deleted once every window has bound one of the new ones.
+struct RetiredPrograms { ShaderPermutations programs; unsigned windows; };
+std::vector<RetiredPrograms> retiredShapePrograms;
+// Windows that must resyncShaders() before their next draw, set whenever a
+// retired set is deleted.
+unsigned resyncWindows = 0;
+ProgramBinaryCache programCache;
+ShaderReloader shaderReloader;
+
+// each variant's uniforms on the glUniform path; shape, shapeColor and pixel
+// are set on both paths
+struct ShapeUniforms {
+    UniformVec2 offset, rotation;
+    UniformFloat scale, pixel;
+    UniformVec3 overrideColor, shape, shapeColor;
+} shapeUniforms[SHAPE_VARIANTS];
+
+// Per-draw shader parameters, laid out exactly like the std140 DrawParams block.
+struct DrawParams {
+    float offset[2];
+    float rotation[2];   // cos, sin
+    float overrideColor[3];
+    float scale;
+};
+static_assert(sizeof(DrawParams) == 32, "DrawParams must match the std140 block");
+
+// Each frame every window's draws are recorded into renderQueue, with their
+// parameters in drawParams (indexed by the command payload), then sorted and
+// submitted window by window.
+std::vector<DrawParams> drawParams;
+RenderQueue renderQueue;
+
+// --shapes N: N extra small shapes per window, drawn above the regular scene.
+struct ExtraShape { MeshId mesh; GLenum mode; float x, y, scale, phase, spin, r, g, b; };
+std::vector<ExtraShape> extraShapes[WIN_COUNT];
+
+// Uniform buffer path: the main window writes all of drawParams into paramRing
+// once per frame, and each draw binds its range. Off with --no-ubo or below GL 3.2.
+bool useUbo = false;
+StreamBuffer paramRing;
+GLintptr paramStride = 0, paramBase = 0;
+GLsync paramsUploaded = 0;
+MeshPool meshPool;
+VaoCache vaoCache;
+Mesh meshes[MESH_COUNT][LOD_COUNT];   // meshes without LODs only fill [0]
+float windowHalfPixels[WIN_COUNT];      // pixels per unit of clip space, refreshed by recordFrame()
+float windowPixel[WIN_COUNT];           // clip-space size of a pixel across the narrower side, likewise
+unsigned long verticesSubmitted = 0;    // --stats: indices drawn, all windows
 GLFWwindow *mainWin=nullptr, *subWin=nullptr, *win2=nullptr;
 
+// --overdraw: how often each window's pixels are shaded per frame. With GL 3.2
+// each window gets a stencil-counting meter and a full histogram; below that,
+// occlusion queries still give the fragment totals.
+bool measureOverdraw = false;
+FragmentCounter fragmentCounters[WIN_COUNT];
+OverdrawMeter overdrawMeters[WIN_COUNT];
+
+// One state shadow per window context; makeCurrent() keeps gl pointing at the
+// current one (stored as the window's user pointer).
+GlState mainGl, subGl, win2Gl;
+GlState* gl = &mainGl;
+
+void makeCurrent(GLFWwindow* w) {
+    glfwMakeContextCurrent(w);
+    gl = static_cast<GlState*>(glfwGetWindowUserPointer(w));
+}
+
 // ----------------- Input Callbacks -----------------
 void main_mouse_callback(GLFWwindow* w, int button, int action, int mods) {
     if (action == GLFW_PRESS && button == GLFW_MOUSE_BUTTON_RIGHT) {
@@ -175,70 +385,533 @@ void win2_key_callback(GLFWwindow* w, int key, int, int action, int) {
 }
 
 // ----------------- Utility + Drawing -----------------
-void setUniforms(float ox, float oy, float scale, float angle, bool useOverride, float r, float g, float b) {
-    glUniform2f(locOffset, ox, oy);
-    glUniform1f(locScale, scale);
-    glUniform1f(locAngle, angle);
-    glUniform1i(locUseOverride, useOverride ? 1 : 0);
-    glUniform3f(locOverrideColor, r, g, b);
+DrawParams makeDrawParams(float ox, float oy, float scale, float angle, float r, float g, float b) {
+    return { { ox, oy }, { cosf(angle), sinf(angle) }, { r, g, b }, scale };
+}
+
+// The shader variant follows from the parameters: no rotation for a zero angle,
+// no color override unless asked for.
+unsigned shapeFeatures(float angle, bool useOverride) {
+    return (useOverride ? FEATURE_OVERRIDE_COLOR : 0) | (angle != 0.0f ? FEATURE_ROTATION : 0);
+}
+
+// Variants this run can draw with; the others are never built.
+unsigned usedFeatures() {
+    unsigned f = FEATURE_OVERRIDE_COLOR | FEATURE_ROTATION;
+    if (procedural) f |= FEATURE_PROCEDURAL;
+    if (sdf) f |= FEATURE_SDF;
+    return f;
+}
+bool variantUsed(unsigned variant) {
+    // --circle-bench draws plain instanced fans and quads, nothing else
+    if (variant & FEATURE_INSTANCED)
+        return circleBenchCount > 0 && (variant == (FEATURE_PROCEDURAL | FEATURE_INSTANCED) ||
+                                        variant == (FEATURE_SDF | FEATURE_INSTANCED));
+    // the vertex comes from one place: attributes, a fan, or a quad
+    if ((variant & FEATURE_PROCEDURAL) && (variant & FEATURE_SDF)) return false;
+    return !(variant & ~usedFeatures());
+}
+
+// A circle of radius r drawn with n segments strays r (1 - cos(pi / n)) from
+// the true rim at the middle of each chord; the level of detail is the
+// coarsest tessellation that keeps that within lodPixelError.
+unsigned lodForRadius(float pixels) {
+    static struct Sagitta {
+        float perRadius[LOD_COUNT];
+        Sagitta() { for (int i=0; i<LOD_COUNT; i++) perRadius[i] = 1.0f - cosf(PI / LOD_SEGMENTS[i]); }
+    } sagitta;
+    if (lodPixelError <= 0.0f) return LOD_FIXED;
+    int lod = 0;
+    while (lod < LOD_COUNT-1 && pixels * sagitta.perRadius[lod] > lodPixelError) lod++;
+    return lod;
+}
+
+// SDF meshes are exact at any size and only fill level 0.
+unsigned selectLod(WindowId win, MeshId mesh, float scale) {
+    if (MESH_RADIUS[mesh] == 0.0f || (meshes[mesh][0].features & FEATURE_SDF)) return 0;
+    return lodForRadius(MESH_RADIUS[mesh] * scale * windowHalfPixels[win]);
+}
+
+const Mesh& keyedMesh(std::uint64_t key) {
+    return meshes[keyMesh(key) / LOD_COUNT][keyMesh(key) % LOD_COUNT];
+}
+
+void queueDraw(WindowId win, unsigned layer, MeshId mesh, GLenum mode,
+               float ox, float oy, float scale, float angle, bool useOverride, float r, float g, float b) {
+    unsigned lod = selectLod(win, mesh, scale);
+    unsigned features = shapeFeatures(angle, useOverride);
+    features |= meshes[mesh][lod].features;
+    renderQueue.push(renderKey(win, layer, features, mesh * LOD_COUNT + lod, mode), std::uint32_t(drawParams.size()));
+    drawParams.push_back(makeDrawParams(ox, oy, scale, angle, r, g, b));
+}
+
+// Records everything the three windows draw this frame, sorted for submission.
+void recordFrame() {
+    renderQueue.clear();
+    drawParams.clear();
+    GLFWwindow* windows[WIN_COUNT] = { mainWin, subWin, win2 };
+    for (int w=0; w<WIN_COUNT; w++) {
+        int fw, fh;
+        glfwGetFramebufferSize(windows[w], &fw, &fh);
+        windowHalfPixels[w] = 0.5f * float(fw > fh ? fw : fh);
+        windowPixel[w] = 2.0f / float(fw < fh ? fw : fh);
+    }
+
+    float r=0,g=0,b=0;
+    if (mainSquareColorMode==0){r=1;g=1;b=1;}
+    else if(mainSquareColorMode==1){r=1;g=0;b=0;}
+    else if(mainSquareColorMode==2){r=0;g=1;b=0;}
+    queueDraw(WIN_MAIN, 0, MESH_ZEBRA, GL_TRIANGLES, 0,0,0.6f,zebraAngle,mainSquareColorMode >= 0,r,g,b);
+
+    queueDraw(WIN_SUB, 0, MESH_ELLIPSE, GL_TRIANGLE_FAN, 0,0,0.8f,0,false,0,0,0);
+
+    float circleScale = 0.3f + 0.15f * sinf(timeAccumulator * 1.5f);
+    queueDraw(WIN_2, 0, MESH_CIRCLE, GL_TRIANGLE_FAN, -0.4f, 0.0f, circleScale, 0.0f, true, w2_R, w2_G, w2_B);
+    queueDraw(WIN_2, 0, MESH_TRIANGLE, GL_TRIANGLES, 0.4f, 0.0f, 1.0f, triAngle, true, w2_R, w2_G, w2_B);
+
+    for (int w=0; w<WIN_COUNT; w++)
+        for (const ExtraShape& e : extraShapes[w])
+            queueDraw(WindowId(w), 1, e.mesh, e.mode,
+                      e.x, e.y, e.scale, e.phase + e.spin * timeAccumulator, true, e.r, e.g, e.b);
+
+    renderQueue.sort();
+}
+
+void setupExtraShapes(int perWindow) {
+    static const MeshId meshIds[] = { MESH_ZEBRA, MESH_ELLIPSE, MESH_CIRCLE, MESH_TRIANGLE };
+    static const GLenum modes[] = { GL_TRIANGLES, GL_TRIANGLE_FAN, GL_TRIANGLE_FAN, GL_TRIANGLES };
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> pos(-0.95f, 0.95f), size(0.03f, 0.08f), spin(-2.0f, 2.0f), unit(0.0f, 1.0f);
+    for (int w=0; w<WIN_COUNT; w++) {
+        extraShapes[w].resize(perWindow);
+        for (ExtraShape& e : extraShapes[w]) {
+            int k = int(rng() % 4);
+            e = { meshIds[k], modes[k], pos(rng), pos(rng), size(rng), 6.2831853f * unit(rng), spin(rng),
+                  unit(rng), unit(rng), unit(rng) };
+        }
+    }
+}
+
+// Main window context current. The fence lets the other windows' contexts wait
+// (on the GPU, not the CPU) until the new contents are visible to them.
+void uploadDrawParams() {
+    if (!useUbo) return;
+    // Closing the previous frame here puts its fence in the main context after
+    // that frame's main window draws, so the main window needs no fence of its own.
+    paramRing.endFrame();
+    StreamBuffer::Allocation a = paramRing.map(drawParams.size() * paramStride, paramStride);
+    if (!a.ptr) return;
+    for (std::size_t i=0; i<drawParams.size(); i++)
+        std::memcpy(static_cast<char*>(a.ptr) + i*paramStride, &drawParams[i], sizeof(DrawParams));
+    paramRing.unmap(a);
+    paramBase = a.offset;
+    if (paramsUploaded) glDeleteSync(paramsUploaded);
+    paramsUploaded = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();   // glWaitSync in another context needs the fence submitted
+}
+
+// Bracket each window's draws; nothing to do in the main window, which uploaded.
+void acquireDrawParams() {
+    if (useUbo && paramsUploaded && glfwGetCurrentContext() != mainWin)
+        glWaitSync(paramsUploaded, 0, GL_TIMEOUT_IGNORED);
+}
+void releaseDrawParams() {
+    if (useUbo && glfwGetCurrentContext() != mainWin) paramRing.fenceReader();
+}
+
+void applyDrawParams(std::uint32_t index, unsigned variant) {
+    if (useUbo) {
+        gl->bindBufferRange(GL_UNIFORM_BUFFER, 0, paramRing.buffer(), paramBase + index*paramStride, sizeof(DrawParams));
+        return;
+    }
+    const DrawParams& p = drawParams[index];
+    ShaderProgram& prog = shapePrograms.get(variant);
+    const ShapeUniforms& u = shapeUniforms[variant];
+    prog.set(u.offset, p.offset[0], p.offset[1]);
+    prog.set(u.scale, p.scale);
+    if (variant & FEATURE_ROTATION) prog.set(u.rotation, p.rotation[0], p.rotation[1]);
+    if (variant & FEATURE_OVERRIDE_COLOR) prog.set(u.overrideColor, p.overrideColor);
+}
+
+// The procedural and SDF variants' shape, from plain uniforms on both paths: it
+// changes per mesh rather than per draw, and the uniform cache drops the repeats.
+void applyMeshParams(const Mesh& m, unsigned variant) {
+    if (!(variant & (FEATURE_PROCEDURAL | FEATURE_SDF))) return;
+    ShaderProgram& prog = shapePrograms.get(variant);
+    prog.set(shapeUniforms[variant].shape, m.shape);
+    prog.set(shapeUniforms[variant].shapeColor, m.shapeColor);
+}
+
+// The SDF quad's margin for the antialiased fringe: one pixel of the target,
+// in clip units.
+void applyPixelSize(unsigned variant, float pixel) {
+    if (!(variant & FEATURE_SDF)) return;
+    shapePrograms.get(variant).set(shapeUniforms[variant].pixel, pixel);
+}
+
+// Indexed draw of m; its vertex and index buffers must already be bound.
+void drawMeshElements(const Mesh& m, GLenum mode) {
+    if (meshPool.baseVertex)
+        glDrawElementsBaseVertex(mode, m.indexCount, m.indexType, (void*)m.indexOffset, m.first);
+    else
+        glDrawElements(mode, m.indexCount, m.indexType, (void*)m.indexOffset);
 }
 
 void drawShape(const Mesh& m, GLenum mode = GL_TRIANGLES) {
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
+    gl->bindVertexArray(vaoCache.get(*gl, glfwGetCurrentContext(), m.layout, meshPool));
+    if (m.layout == VertexLayout::None) glDrawArrays(mode, 0, m.vertexCount);
+    else drawMeshElements(m, mode);
+}
+
+// The pre-VAO path: attribute pointers re-specified on the default VAO before every draw.
+void drawShapeLegacy(const Mesh& m, GLenum mode = GL_TRIANGLES) {
+    gl->bindBuffer(GL_ARRAY_BUFFER, meshPool.VBO);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(2*sizeof(float)));
     glEnableVertexAttribArray(1);
-    glDrawArrays(mode, 0, m.vertexCount);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshPool.EBO);
+    drawMeshElements(m, mode);
 }
 
-// ----------------- Rendering -----------------
-void renderMain() {
-    glfwMakeContextCurrent(mainWin);
-    glClearColor(0.05f,0.05f,0.05f,1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(program);
+// --measure-draws: CPU time to submit a batch of small draws through each path,
+// in every window. Draws go to the back buffer, which is cleared and never shown.
+void measureDraws(GLFWwindow* w, const char* name, int draws) {
+    typedef std::chrono::steady_clock Clock;
+    makeCurrent(w);
+    gl->useProgram(shapePrograms.get(FEATURE_OVERRIDE_COLOR).id());
+    acquireDrawParams();
+    applyDrawParams(0, FEATURE_OVERRIDE_COLOR);
+    for (int pass=0; pass<2; pass++) {
+        bool vao = pass == 1;
+        if (!vao) gl->bindVertexArray(0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glFinish();
+        Clock::time_point t0 = Clock::now();
+        for (int i=0; i<draws; i++) {
+            if (vao) drawShape(meshes[MESH_TRIANGLE][0]);
+            else drawShapeLegacy(meshes[MESH_TRIANGLE][0]);
+        }
+        double submit = std::chrono::duration<double>(Clock::now() - t0).count();
+        glFinish();
+        std::cout << name << (vao ? "  vao bind:   " : "  re-spec:    ")
+                  << submit * 1e9 / draws << " ns/draw" << std::endl;
+    }
+    releaseDrawParams();
+}
 
-    bool useOverride = (mainSquareColorMode >= 0);
-    float r=0,g=0,b=0;
-    if (mainSquareColorMode==0){r=1;g=1;b=1;}
-    else if(mainSquareColorMode==1){r=1;g=0;b=0;}
-    else if(mainSquareColorMode==2){r=0;g=1;b=0;}
+// --vertex-bench: vertex throughput of every shader variant on a finely
+// tessellated ellipse, drawn so small that rasterization cost is negligible.
+// The procedural variants (--procedural) draw the same ellipse generated from
+// gl_VertexID instead.
+void vertexBench(const Mesh& stored, const Mesh& generated) {
+    typedef std::chrono::steady_clock Clock;
+    const int REPS = 10;
+    makeCurrent(mainWin);
+    for (unsigned v=0; v<SHAPE_VARIANTS; v++) {
+        // an SDF quad has four vertices whatever its size; see --circle-bench
+        if (!variantUsed(v) || (v & (FEATURE_SDF | FEATURE_INSTANCED))) continue;
+        const Mesh& m = (v & FEATURE_PROCEDURAL) ? generated : stored;
+        drawParams.assign(1, makeDrawParams(0, 0, 0.001f, (v & FEATURE_ROTATION) ? 0.5f : 0.0f, 1, 1, 1));
+        uploadDrawParams();
+        gl->useProgram(shapePrograms.get(v).id());
+        applyDrawParams(0, v);
+        applyMeshParams(m, v);
+        drawShape(m, GL_TRIANGLE_FAN);   // warm up
+        glFinish();
+        Clock::time_point t0 = Clock::now();
+        for (int i=0; i<REPS; i++) drawShape(m, GL_TRIANGLE_FAN);
+        glFinish();
+        double t = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << shapePrograms.get(v).label() << ": " << double(m.indexCount) * REPS / t * 1e-6
+                  << " Mverts/s" << std::endl;
+    }
+}
 
-    setUniforms(0,0,0.6f,zebraAngle,useOverride,r,g,b);
-    drawShape(zebraMesh);
+// --circle-bench: `count` circles of each of several sizes in one instanced
+// draw, once as procedural fans with the segments the level of detail rule
+// gives that size and once as SDF quads, in the main window's back buffer.
+// Larger sizes draw fewer circles, so that no size covers the window more
+// than CIRCLE_BENCH_COVER times over.
+void circleBench(int count) {
+    typedef std::chrono::steady_clock Clock;
+    const float RADII[] = { 2, 8, 32, 128 };   // pixels
+    const float CIRCLE_BENCH_COVER = 64.0f;
+    const int REPS = 3;
+    if (!GLAD_GL_VERSION_3_3) {
+        std::cerr << "--circle-bench needs OpenGL 3.3 (instanced draws with attribute divisors)" << std::endl;
+        return;
+    }
+    makeCurrent(mainWin);
+    int fw, fh;
+    glfwGetFramebufferSize(mainWin, &fw, &fh);
+    float halfPixels = 0.5f * float(fw > fh ? fw : fh);
+
+    // per instance: x, y, scale, r, g, b
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    gl->bindVertexArray(vao);
+    gl->bindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)(3*sizeof(float)));
+    // attribute 0 only has to be enabled (see enableZeroAttribute()); the fans
+    // are built after the pool's zeros, so it reads the instances instead
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
+    for (GLuint a : { 0u, 2u, 3u }) {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    drawParams.assign(1, makeDrawParams(0, 0, 1, 0, 1, 1, 1));
+    uploadDrawParams();
 
-    glfwSwapBuffers(mainWin);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> pos(-1.0f, 1.0f), unit(0.0f, 1.0f);
+    std::vector<float> instances;
+    for (float radius : RADII) {
+        int n = std::min(count, int(CIRCLE_BENCH_COVER * fw * fh / (PI * radius * radius)));
+        instances.resize(std::size_t(n) * 6);
+        for (int i=0; i<n; i++) {
+            float* c = &instances[std::size_t(i) * 6];
+            c[0] = pos(rng); c[1] = pos(rng); c[2] = radius / halfPixels;
+            c[3] = unit(rng); c[4] = unit(rng); c[5] = unit(rng);
+        }
+        glBufferData(GL_ARRAY_BUFFER, instances.size()*sizeof(float), instances.data(), GL_STATIC_DRAW);
+        int segments = LOD_SEGMENTS[lodForRadius(radius)];
+        Mesh fan = makeProceduralMesh(meshPool, "bench fan", FEATURE_PROCEDURAL, segments, 1, 1, 1, 1, 1);
+        Mesh quad = makeProceduralMesh(meshPool, "bench quad", FEATURE_SDF, 0, 1, 1, 1, 1, 1);
+        for (const Mesh* m : { &fan, &quad }) {
+            unsigned v = m->features | FEATURE_INSTANCED;
+            gl->useProgram(shapePrograms.get(v).id());
+            applyDrawParams(0, v);
+            applyMeshParams(*m, v);
+            applyPixelSize(v, 2.0f / float(fw < fh ? fw : fh));
+            if (v & FEATURE_SDF) gl->enable(GL_BLEND);
+            else gl->disable(GL_BLEND);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, m->vertexCount, n);   // warm up
+            glFinish();
+            Clock::time_point t0 = Clock::now();
+            for (int i=0; i<REPS; i++) glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, m->vertexCount, n);
+            glFinish();
+            double t = std::chrono::duration<double>(Clock::now() - t0).count() / REPS;
+            std::cout << "radius " << radius << " px, " << n << " circles, "
+                      << ((v & FEATURE_SDF) ? std::string("SDF quad") : "fan/" + std::to_string(segments)) << ": "
+                      << 1e3 * t << " ms, " << n / t * 1e-6 << " Mcircles/s" << std::endl;
+        }
+    }
+    gl->disable(GL_BLEND);
+    gl->bindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    gl->bindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &vbo);
 }
 
-void renderSub() {
-    glfwMakeContextCurrent(subWin);
-    glClearColor(subBgR, subBgG, subBgB, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(program);
-    setUniforms(0,0,0.8f,0,false,0,0,0);
-    drawShape(ellipseMesh,GL_TRIANGLE_FAN);
-    glfwSwapBuffers(subWin);
+// --overdraw report, one line per window: shading per frame since the last
+// report, or over the whole run. Per pixel divides by the window's pixels,
+// so shapes covering a quarter of it without overlapping give 0.25.
+void reportOverdraw(bool wholeRun = false) {
+    static const char* names[WIN_COUNT] = { "main", "sub", "win2" };
+    static FragmentCounter::Counters reported[WIN_COUNT];
+    static OverdrawMeter::Histogram reportedHist[WIN_COUNT];
+    GLFWwindow* windows[WIN_COUNT] = { mainWin, subWin, win2 };
+    for (int w=0; w<WIN_COUNT; w++) {
+        std::string label = std::string("overdraw ") + names[w] + (wholeRun ? " (whole run)" : "");
+        if (OverdrawMeter::supported()) {
+            printOverdraw(label.c_str(), overdrawMeters[w], wholeRun ? OverdrawMeter::Histogram() : reportedHist[w]);
+            reportedHist[w] = overdrawMeters[w].histogram();
+            continue;
+        }
+        const FragmentCounter::Counters& c = fragmentCounters[w].counters();
+        const FragmentCounter::Counters& since = wholeRun ? FragmentCounter::Counters() : reported[w];
+        unsigned long frames = c.frames - since.frames;
+        reported[w] = c;
+        if (!frames) continue;
+        double perFrame = double(c.fragments - since.fragments) / frames;
+        int fw, fh;
+        glfwGetFramebufferSize(windows[w], &fw, &fh);
+        std::cout << label << ": " << perFrame << " fragments/frame, " << perFrame / (double(fw) * fh)
+                  << " per pixel" << std::endl;
+    }
 }
 
-void renderWin2() {
-    glfwMakeContextCurrent(win2);
-    glClearColor(0.1f,0.1f,0.1f,1.0f);
+// ----------------- Rendering -----------------
+// Mesa's state tracker (22.3; llvmpipe and softpipe alike) gives each context
+// its own compiled copies of a program. Deleting the program from another
+// context leaves them to be freed at this context's next flush, which unbinds
+// them in the driver behind the context's own cache of what is bound: a draw
+// with the same program as the previous one then skips the rebind and runs with
+// no shaders at all. So after a delete each window flushes and draws one
+// discarded point with a different program, which rebinds for real, before it
+// draws anything else. Elsewhere this costs a flush and an empty draw.
+void resyncShaders(WindowId id) {
+    glFlush();
+    for (unsigned v=0; v<SHAPE_VARIANTS; v++) {
+        if (!variantUsed(v) || shapePrograms.get(v).id() == gl->currentProgram()) continue;
+        gl->useProgram(shapePrograms.get(v).id());
+        gl->bindVertexArray(vaoCache.get(*gl, glfwGetCurrentContext(), VertexLayout::PosColor, meshPool));
+        glEnable(GL_RASTERIZER_DISCARD);
+        glDrawArrays(GL_POINTS, 0, 1);
+        glDisable(GL_RASTERIZER_DISCARD);
+        break;
+    }
+    resyncWindows &= ~(1u << id);
+}
+
+// Submits one window's slice [cmd, end) of the sorted queue and presents it.
+void renderWindow(WindowId id, GLFWwindow* w, float r, float g, float b,
+                  const RenderCommand* cmd, const RenderCommand* end) {
+    makeCurrent(w);
+    if (resyncWindows & (1u << id)) resyncShaders(id);
+    bool meter = measureOverdraw && OverdrawMeter::supported();
+    bool queries = measureOverdraw && !meter;
+    if (meter) {
+        int fw, fh;
+        glfwGetFramebufferSize(w, &fw, &fh);
+        overdrawMeters[id].begin(fw, fh);
+    }
+    gl->clearColor(r, g, b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(program);
+    if (queries) fragmentCounters[id].begin();
+    acquireDrawParams();
+    for (; cmd != end; ++cmd) {
+        unsigned variant = keyProgram(cmd->key);
+        gl->useProgram(shapePrograms.get(variant).id());
+        applyDrawParams(cmd->payload, variant);
+        const Mesh& m = keyedMesh(cmd->key);
+        applyMeshParams(m, variant);
+        applyPixelSize(variant, windowPixel[id]);
+        if (variant & FEATURE_SDF) gl->enable(GL_BLEND);
+        else gl->disable(GL_BLEND);
+        verticesSubmitted += m.indexCount;
+        drawShape(m, keyMode(cmd->key));
+    }
+    releaseDrawParams();
+    if (queries) fragmentCounters[id].end();
+    if (meter) overdrawMeters[id].end();
+    glfwSwapBuffers(w);
+}
 
-    float circleScale = 0.3f + 0.15f * sinf(timeAccumulator * 1.5f);
-    setUniforms(-0.4f, 0.0f, circleScale, 0.0f, true, w2_R, w2_G, w2_B);
-    drawShape(circleMesh, GL_TRIANGLE_FAN);
+// Window id's context is current and no longer uses any retired program
+// (every window draws each frame, so it has bound current programs since);
+// deletes the sets every window has moved on from.
+void releaseRetiredPrograms(WindowId id) {
+    for (std::size_t i=0; i<retiredShapePrograms.size(); ) {
+        RetiredPrograms& r = retiredShapePrograms[i];
+        r.windows &= ~(1u << id);
+        if (r.windows) { i++; continue; }
+        r.programs.destroy();
+        retiredShapePrograms.erase(retiredShapePrograms.begin() + i);
+        resyncWindows = (1u << WIN_COUNT) - 1;
+    }
+}
 
-    setUniforms(0.4f, 0.0f, 1.0f, triAngle, true, w2_R, w2_G, w2_B);
-    drawShape(triangleMesh);
+void renderFrame() {
+    struct { GLFWwindow* window; float r, g, b; } targets[WIN_COUNT] = {
+        { mainWin, 0.05f, 0.05f, 0.05f },
+        { subWin, subBgR, subBgG, subBgB },
+        { win2, 0.1f, 0.1f, 0.1f },
+    };
+    const RenderCommand* cmd = renderQueue.begin();
+    for (int w=0; w<WIN_COUNT; w++) {
+        const RenderCommand* first = cmd;
+        while (cmd != renderQueue.end() && keyWindow(cmd->key) == unsigned(w)) ++cmd;
+        GLFWwindow* win = targets[w].window;
+        if (!win) continue;
+        bool open = win == mainWin || !glfwWindowShouldClose(win);
+        if (open) renderWindow(WindowId(w), win, targets[w].r, targets[w].g, targets[w].b, first, cmd);
+        if (retiredShapePrograms.empty()) continue;
+        if (!open) {
+            // a closed window draws nothing more; unbind whatever it last drew with
+            makeCurrent(win);
+            gl->useProgram(0);
+        }
+        releaseRetiredPrograms(WindowId(w));
+    }
+}
+
+// ----------------- Programs -----------------
+// Reads the shader pair for the current path (uniform buffer or glUniform);
+// the fragment shader is that path's #version plus the shared body.
+bool initShapePrograms(ShaderPermutations& programs) {
+    std::string base = std::string(SHADER_DIR) + (useUbo ? "/shapes_ubo" : "/shapes"), vs, fs, body;
+    if (!loadShaderSource(base + ".vert", vs) || !loadShaderSource(base + ".frag", fs) ||
+        !loadShaderSource(std::string(SHADER_DIR) + "/shapes_fragment.glsl", body)) return false;
+    fs += body;
+    programs.init(std::move(vs), std::move(fs), "shapes", { "OVERRIDE_COLOR", "ROTATION", "PROCEDURAL", "SDF", "INSTANCED" });
+    return true;
+}
+
+// Waits for every variant and resolves its handles for the glUniform path.
+void resolveShapeUniforms() {
+    for (unsigned v=0; v<SHAPE_VARIANTS; v++) {
+        if (!variantUsed(v)) continue;
+        ShaderProgram& p = shapePrograms.get(v);
+        // the color comes from the mesh unless overridden or per instance
+        bool generated = (v & (FEATURE_PROCEDURAL | FEATURE_SDF)) != 0;
+        shapeUniforms[v].shape = p.uniform<GL_FLOAT_VEC3>("shape", generated);
+        shapeUniforms[v].shapeColor = p.uniform<GL_FLOAT_VEC3>("shapeColor",
+            generated && !(v & (FEATURE_OVERRIDE_COLOR | FEATURE_INSTANCED)));
+        shapeUniforms[v].pixel = p.uniform<GL_FLOAT>("pixel", (v & FEATURE_SDF) != 0);
+        if (useUbo) continue;
+        shapeUniforms[v].offset = p.uniform<GL_FLOAT_VEC2>("offset");
+        shapeUniforms[v].scale = p.uniform<GL_FLOAT>("scale");
+        shapeUniforms[v].rotation = p.uniform<GL_FLOAT_VEC2>("rotation", (v & FEATURE_ROTATION) != 0);
+        shapeUniforms[v].overrideColor = p.uniform<GL_FLOAT_VEC3>("overrideColor", (v & FEATURE_OVERRIDE_COLOR) != 0);
+    }
+}
 
-    glfwSwapBuffers(win2);
+// --hot-reload: all variants are rebuilt together and swapped in only if every
+// one of them linked. Uniforms are set per draw, so nothing needs re-setting.
+// The old programs live on until each window has bound a new one (see
+// releaseRetiredPrograms()).
+void watchShapePrograms() {
+    stagedShapePrograms.base = shapePrograms.base;
+    std::string prefix = useUbo ? "shapes_ubo" : "shapes";
+    shaderReloader.add({ "shapes", { prefix + ".vert", prefix + ".frag", "shapes_fragment.glsl" },
+        []() {
+            stagedShapePrograms.destroy();
+            if (!initShapePrograms(stagedShapePrograms)) return false;
+            stagedShapePrograms.submitAll(variantUsed);
+            bool ok = true;
+            for (unsigned v=0; v<SHAPE_VARIANTS; v++)
+                if (variantUsed(v)) ok = stagedShapePrograms.get(v).valid() && ok;
+            return ok;
+        },
+        []() {
+            std::swap(shapePrograms, stagedShapePrograms);
+            retiredShapePrograms.push_back({ std::move(stagedShapePrograms), (1u << WIN_COUNT) - 1 });
+            stagedShapePrograms = ShaderPermutations();
+            stagedShapePrograms.base = shapePrograms.base;
+            resolveShapeUniforms();
+        } });
 }
 
 // ----------------- Main -----------------
-int main() {
+int main(int argc, char** argv) {
+    auto processStart = std::chrono::steady_clock::now();
+    int measureDrawCount = 0, vertexBenchSegments = 0, maxFrames = 0;
+    bool noUbo = false, stats = false, programCacheOn = true, startupTime = false, hotReload = false;
+    for (int i=1; i<argc; i++) {
+        if (!std::strcmp(argv[i], "--measure-draws"))
+            measureDrawCount = (i+1 < argc && argv[i+1][0] != '-') ? std::atoi(argv[++i]) : 20000;
+        else if (!std::strcmp(argv[i], "--no-ubo")) noUbo = true;
+        else if (!std::strcmp(argv[i], "--stats")) stats = true;
+        else if (!std::strcmp(argv[i], "--no-program-cache")) programCacheOn = false;
+        else if (!std::strcmp(argv[i], "--startup-time")) startupTime = true;
+        else if (!std::strcmp(argv[i], "--hot-reload")) hotReload = true;
+        else if (!std::strcmp(argv[i], "--overdraw")) measureOverdraw = true;
+        else if (!std::strcmp(argv[i], "--frames") && i+1 < argc) maxFrames = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--procedural")) procedural = true;
+        else if (!std::strcmp(argv[i], "--sdf")) sdf = true;
+        else if (!std::strcmp(argv[i], "--circle-bench"))
+            circleBenchCount = (i+1 < argc && argv[i+1][0] != '-') ? std::atoi(argv[++i]) : 1 << 20;
+        else if (!std::strcmp(argv[i], "--lod-error") && i+1 < argc) lodPixelError = float(std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--vertex-bench"))
+            vertexBenchSegments = (i+1 < argc && argv[i+1][0] != '-') ? std::atoi(argv[++i]) : 1 << 20;
+        else if (!std::strcmp(argv[i], "--shapes") && i+1 < argc) setupExtraShapes(std::atoi(argv[++i]));
+    }
+
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
@@ -246,33 +919,130 @@ int main() {
 
     mainWin = glfwCreateWindow(MAIN_W, MAIN_H, "Main Window", NULL, NULL);
     if (!mainWin) return -1;
+    glfwSetWindowUserPointer(mainWin, &mainGl);
     glfwMakeContextCurrent(mainWin);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
     glfwSwapInterval(1);
 
-    program = compileProgram(vertexShaderSrc, fragmentShaderSrc);
-    locOffset = glGetUniformLocation(program, "offset");
-    locScale = glGetUniformLocation(program, "scale");
-    locAngle = glGetUniformLocation(program, "angle");
-    locUseOverride = glGetUniformLocation(program, "useOverride");
-    locOverrideColor = glGetUniformLocation(program, "overrideColor");
+    if (stats) countGlCalls();
+    useUbo = !noUbo && GLAD_GL_VERSION_3_2;
+    auto buildStart = std::chrono::steady_clock::now();
+    if (programCacheOn && programCache.open(".shader_cache")) shapePrograms.base.useBinaryCache(&programCache);
+    // VaoCache sets up attributes 0 and 1, whichever program draws
+    shapePrograms.base.bindAttribute(0, "aPos");
+    shapePrograms.base.bindAttribute(1, "aColor");
+    shapePrograms.base.bindAttribute(2, "iTransform");   // --circle-bench only
+    shapePrograms.base.bindAttribute(3, "iColor");
+    if (!initShapePrograms(shapePrograms)) return -1;
+    if (useUbo) {
+        shapePrograms.base.bindBlock("DrawParams", 0);
+        GLint align = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        paramStride = (sizeof(DrawParams) + align - 1) / align * align;
+        std::size_t maxDraws = 4;
+        for (const std::vector<ExtraShape>& e : extraShapes) maxDraws += e.size();
+        paramRing.create(4 * maxDraws * paramStride);
+    }
+    // the variants this run uses are cheap enough to build up front, which also
+    // resolves their handles before the first frame; the driver compiles them
+    // while the meshes and the other windows are set up
+    shapePrograms.submitAll(variantUsed);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
 
     std::vector<float> tmp;
-    buildZebra(tmp); zebraMesh = makeMesh(tmp);
-    buildEllipse(tmp); ellipseMesh = makeMesh(tmp);
-    buildCircle(tmp); circleMesh = makeMesh(tmp);
-    buildTriangle(tmp); triangleMesh = makeMesh(tmp);
+    meshPool.baseVertex = GLAD_GL_VERSION_3_2;
+    meshPool.report = stats;
+    buildZebra(tmp); meshes[MESH_ZEBRA][0] = makeMesh(meshPool, "zebra", tmp);
+    if (sdf) {
+        meshes[MESH_ELLIPSE][0] = makeProceduralMesh(meshPool, "ellipse", FEATURE_SDF, 0, 0.5f, 0.3f, 1.0f, 0.5f, 0.0f);
+        meshes[MESH_CIRCLE][0] = makeProceduralMesh(meshPool, "circle", FEATURE_SDF, 0, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    for (int lod=0; !sdf && lod<LOD_COUNT; lod++) {
+        int seg = LOD_SEGMENTS[lod];
+        std::string ellipse = "ellipse/" + std::to_string(seg), circle = "circle/" + std::to_string(seg);
+        if (procedural) {
+            meshes[MESH_ELLIPSE][lod] =
+                makeProceduralMesh(meshPool, ellipse.c_str(), FEATURE_PROCEDURAL, seg, 0.5f, 0.3f, 1.0f, 0.5f, 0.0f);
+            meshes[MESH_CIRCLE][lod] =
+                makeProceduralMesh(meshPool, circle.c_str(), FEATURE_PROCEDURAL, seg, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+            continue;
+        }
+        buildEllipse(tmp, seg); meshes[MESH_ELLIPSE][lod] = makeMesh(meshPool, ellipse.c_str(), tmp);
+        buildCircle(tmp, seg); meshes[MESH_CIRCLE][lod] = makeMesh(meshPool, circle.c_str(), tmp);
+    }
+    if (procedural)
+        meshes[MESH_TRIANGLE][0] = makeProceduralMesh(meshPool, "triangle", FEATURE_PROCEDURAL, 0, 0, 0, 1.0f, 1.0f, 1.0f);
+    else { buildTriangle(tmp); meshes[MESH_TRIANGLE][0] = makeMesh(meshPool, "triangle", tmp); }
+    Mesh benchMesh, benchProcedural;
+    if (vertexBenchSegments > 0) {
+        buildEllipse(tmp, vertexBenchSegments); benchMesh = makeMesh(meshPool, "bench ellipse", tmp);
+        if (procedural)
+            benchProcedural = makeProceduralMesh(meshPool, "bench ellipse", FEATURE_PROCEDURAL, vertexBenchSegments,
+                                                 0.5f, 0.3f, 1.0f, 0.5f, 0.0f);
+    }
+
+    uploadMeshPool(mainGl, meshPool);
 
     subWin = glfwCreateWindow(SUB_W, SUB_H, "Sub-Window", NULL, mainWin);
     win2   = glfwCreateWindow(W2_W, W2_H, "Window 2", NULL, mainWin);
+    glfwSetWindowUserPointer(subWin, &subGl);
+    glfwSetWindowUserPointer(win2, &win2Gl);
+
+    // SDF shapes blend their antialiased rims; nothing else turns blending on
+    for (GLFWwindow* w : { mainWin, subWin, win2 }) {
+        makeCurrent(w);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    makeCurrent(mainWin);
 
     glfwSetMouseButtonCallback(mainWin, main_mouse_callback);
     glfwSetKeyCallback(mainWin, main_key_callback);
     glfwSetMouseButtonCallback(subWin, sub_mouse_callback);
     glfwSetKeyCallback(win2, win2_key_callback);
 
+    buildStart = std::chrono::steady_clock::now();
+    resolveShapeUniforms();
+    buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    if (hotReload) {
+        watchShapePrograms();
+        shaderReloader.start(SHADER_DIR, mainWin);
+    }
+
+    if (vertexBenchSegments > 0) vertexBench(benchMesh, benchProcedural);
+    if (circleBenchCount > 0) circleBench(circleBenchCount);
+
+    // the legacy path re-specifies attributes, which procedural meshes have none of
+    if (measureDrawCount > 0 && procedural)
+        std::cerr << "--measure-draws: not available with --procedural" << std::endl;
+    else if (measureDrawCount > 0) {
+        makeCurrent(mainWin);
+        drawParams.assign(1, makeDrawParams(0.4f, 0.0f, 1.0f, 0.0f, 1, 1, 1));
+        uploadDrawParams();
+        measureDraws(mainWin, "main", measureDrawCount);
+        measureDraws(subWin, "sub ", measureDrawCount);
+        measureDraws(win2, "win2", measureDrawCount);
+    }
+
     double lastTime = glfwGetTime();
-    while (!glfwWindowShouldClose(mainWin)) {
+    double statsStart = lastTime, overdrawStart = lastTime;
+    auto filteredCalls = []() {
+        return mainGl.counters().filtered + subGl.counters().filtered + win2Gl.counters().filtered;
+    };
+    unsigned long statsCalls = glCallCount, statsFiltered = filteredCalls(), statsVertices = verticesSubmitted;
+    int statsFrames = 0;
+    double statsRecordSeconds = 0.0;
+    auto uniformCounters = []() {
+        UniformCache::Counters sum;
+        for (unsigned v=0; v<SHAPE_VARIANTS; v++) {
+            if (!variantUsed(v)) continue;
+            sum.hits += shapePrograms.get(v).uniformCounters().hits;
+            sum.misses += shapePrograms.get(v).uniformCounters().misses;
+        }
+        return sum;
+    };
+    UniformCache::Counters statsUniforms = uniformCounters();
+    // --frames N: quit after N frames, for scripted runs
+    for (int frame=0; !glfwWindowShouldClose(mainWin) && (maxFrames <= 0 || frame < maxFrames); frame++) {
         double currentTime = glfwGetTime();
         double dt = currentTime - lastTime;
         lastTime = currentTime;
@@ -282,11 +1052,69 @@ int main() {
             triAngle -= 1.2f * dt;
         }
         glfwPollEvents();
-        renderMain();
-        if (subWin && !glfwWindowShouldClose(subWin)) renderSub();
-        if (win2 && !glfwWindowShouldClose(win2)) renderWin2();
+        // new programs count their uniform uploads from zero
+        if (shaderReloader.poll()) statsUniforms = UniformCache::Counters();
+        auto recordStart = std::chrono::steady_clock::now();
+        recordFrame();
+        statsRecordSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - recordStart).count();
+        makeCurrent(mainWin);
+        uploadDrawParams();
+        renderFrame();
+        if (startupTime) {
+            glFinish();
+            printStartupTime(processStart, buildSeconds, programCache);
+            startupTime = false;
+        }
+
+        if (measureOverdraw && currentTime - overdrawStart >= 1.0) {
+            reportOverdraw();
+            overdrawStart = currentTime;
+        }
+        if (stats) {
+            statsFrames++;
+            if (currentTime - statsStart >= 1.0) {
+                std::cout << (useUbo ? "uniform buffer" : "glUniform") << ": "
+                          << double(glCallCount - statsCalls) / statsFrames << " GL calls/frame, "
+                          << double(filteredCalls() - statsFiltered) / statsFrames << " redundant state calls/frame filtered, "
+                          << renderQueue.size() << " draws recorded+sorted in "
+                          << 1e6 * statsRecordSeconds / statsFrames << " us, "
+                          << double(verticesSubmitted - statsVertices) / statsFrames << " vertices/frame";
+                UniformCache::Counters u = uniformCounters();
+                if (!useUbo)
+                    std::cout << ", uniform uploads skipped/sent: " << double(u.hits - statsUniforms.hits) / statsFrames
+                              << "/" << double(u.misses - statsUniforms.misses) / statsFrames;
+                std::cout << std::endl;
+                statsStart = currentTime; statsCalls = glCallCount; statsFrames = 0;
+                statsFiltered = filteredCalls(); statsRecordSeconds = 0.0; statsUniforms = u;
+                statsVertices = verticesSubmitted;
+            }
+        }
     }
 
+    if (measureOverdraw) {
+        // picks up the last frames, still in flight
+        GLFWwindow* windows[WIN_COUNT] = { mainWin, subWin, win2 };
+        for (int w=0; w<WIN_COUNT; w++) {
+            makeCurrent(windows[w]);
+            if (OverdrawMeter::supported()) overdrawMeters[w].finish();
+            else fragmentCounters[w].finish();
+        }
+        reportOverdraw(true);
+    }
+    GLFWwindow* windows[WIN_COUNT] = { mainWin, subWin, win2 };
+    for (WindowId w : { WIN_SUB, WIN_2, WIN_MAIN }) {
+        glfwMakeContextCurrent(windows[w]);
+        vaoCache.release(windows[w]);
+        fragmentCounters[w].destroy();
+        overdrawMeters[w].destroy();
+    }
+    glfwMakeContextCurrent(mainWin);
+    if (paramsUploaded) glDeleteSync(paramsUploaded);
+    paramRing.destroy();
+    shaderReloader.stop();
+    shapePrograms.destroy();
+    stagedShapePrograms.destroy();
+    for (RetiredPrograms& r : retiredShapePrograms) r.programs.destroy();
     glfwTerminate();
     return 0;
 }
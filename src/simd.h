@@ -0,0 +1,116 @@
+#pragma once
+// Minimal 4-wide float vector wrapper shared by the matrix and transform kernels.
+// NEON on aarch64, SSE on x86, plain arrays everywhere else.
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+typedef float32x4_t f32x4;
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define SIMD_SSE 1
+typedef __m128 f32x4;
+#else
+#include <cmath>
+#define SIMD_SCALAR 1
+struct f32x4 { float v[4]; };
+#endif
+
+#if defined(SIMD_NEON)
+
+inline f32x4 simdLoad(const float* p) { return vld1q_f32(p); }
+inline void simdStore(float* p, f32x4 a) { vst1q_f32(p, a); }
+inline f32x4 simdSplat(float x) { return vdupq_n_f32(x); }
+inline f32x4 simdSet(float x, float y, float z, float w) { float t[4]={x,y,z,w}; return vld1q_f32(t); }
+inline f32x4 simdAdd(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+inline f32x4 simdSub(f32x4 a, f32x4 b) { return vsubq_f32(a, b); }
+inline f32x4 simdMul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+inline f32x4 simdMadd(f32x4 a, f32x4 b, f32x4 c) { return vmlaq_f32(c, a, b); }   // a*b + c
+inline f32x4 simdSwapPairs(f32x4 a) { return vrev64q_f32(a); }                    // (y,x,w,z)
+inline f32x4 simdRound(f32x4 a) { return vrndnq_f32(a); }
+inline void simdStoreStream(float* p, f32x4 a) { vst1q_f32(p, a); }
+inline void simdStreamFence() {}
+inline void simdTranspose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+    float32x4x2_t t01 = vtrnq_f32(r0, r1), t23 = vtrnq_f32(r2, r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]),  vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]),  vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+#elif defined(SIMD_SSE)
+
+inline f32x4 simdLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void simdStore(float* p, f32x4 a) { _mm_storeu_ps(p, a); }
+inline f32x4 simdSplat(float x) { return _mm_set1_ps(x); }
+inline f32x4 simdSet(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+inline f32x4 simdAdd(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+inline f32x4 simdSub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+inline f32x4 simdMul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+#if defined(__FMA__)
+inline f32x4 simdMadd(f32x4 a, f32x4 b, f32x4 c) { return _mm_fmadd_ps(a, b, c); }
+#else
+inline f32x4 simdMadd(f32x4 a, f32x4 b, f32x4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#endif
+inline f32x4 simdSwapPairs(f32x4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1)); }
+inline f32x4 simdRound(f32x4 a) {
+    // SSE2 has no round instruction; adding and removing 1.5*2^23 rounds to nearest
+    // for |a| < 2^22, which covers every angle the kernels see
+    const __m128 magic = _mm_set1_ps(12582912.0f);
+    return _mm_sub_ps(_mm_add_ps(a, magic), magic);
+}
+// non-temporal store, p must be 16-byte aligned; call simdStreamFence() when done
+inline void simdStoreStream(float* p, f32x4 a) { _mm_stream_ps(p, a); }
+inline void simdStreamFence() { _mm_sfence(); }
+inline void simdTranspose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+#else
+
+inline f32x4 simdLoad(const float* p) { return {{p[0],p[1],p[2],p[3]}}; }
+inline void simdStore(float* p, f32x4 a) { for (int i=0;i<4;i++) p[i]=a.v[i]; }
+inline f32x4 simdSplat(float x) { return {{x,x,x,x}}; }
+inline f32x4 simdSet(float x, float y, float z, float w) { return {{x,y,z,w}}; }
+inline f32x4 simdAdd(f32x4 a, f32x4 b) { for (int i=0;i<4;i++) a.v[i]+=b.v[i]; return a; }
+inline f32x4 simdSub(f32x4 a, f32x4 b) { for (int i=0;i<4;i++) a.v[i]-=b.v[i]; return a; }
+inline f32x4 simdMul(f32x4 a, f32x4 b) { for (int i=0;i<4;i++) a.v[i]*=b.v[i]; return a; }
+inline f32x4 simdMadd(f32x4 a, f32x4 b, f32x4 c) { for (int i=0;i<4;i++) c.v[i]+=a.v[i]*b.v[i]; return c; }
+inline f32x4 simdSwapPairs(f32x4 a) { return {{a.v[1],a.v[0],a.v[3],a.v[2]}}; }
+inline f32x4 simdRound(f32x4 a) { for (int i=0;i<4;i++) a.v[i]=std::nearbyint(a.v[i]); return a; }
+inline void simdStoreStream(float* p, f32x4 a) { simdStore(p, a); }
+inline void simdStreamFence() {}
+inline void simdTranspose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+    f32x4 t0={{r0.v[0],r1.v[0],r2.v[0],r3.v[0]}}, t1={{r0.v[1],r1.v[1],r2.v[1],r3.v[1]}};
+    f32x4 t2={{r0.v[2],r1.v[2],r2.v[2],r3.v[2]}}, t3={{r0.v[3],r1.v[3],r2.v[3],r3.v[3]}};
+    r0=t0; r1=t1; r2=t2; r3=t3;
+}
+
+#endif
+
+// sin and cos of four angles at once, accurate to ~1e-6 for any angle the
+// transform code produces. The angle is wrapped to [-pi, pi], halved, evaluated
+// with Taylor polynomials on [-pi/2, pi/2] and recombined with the double-angle
+// identities, so there are no per-lane branches or quadrant selects.
+inline void simdSinCos(f32x4 x, f32x4& s, f32x4& c) {
+    const f32x4 inv2pi = simdSplat(0.159154943f), twoPi = simdSplat(6.28318531f);
+    x = simdSub(x, simdMul(simdRound(simdMul(x, inv2pi)), twoPi));
+    f32x4 h = simdMul(x, simdSplat(0.5f));
+    f32x4 h2 = simdMul(h, h);
+
+    f32x4 ps = simdSplat(-2.50521084e-8f);                 // -1/11!
+    ps = simdMadd(ps, h2, simdSplat( 2.75573192e-6f));     //  1/9!
+    ps = simdMadd(ps, h2, simdSplat(-1.98412698e-4f));     // -1/7!
+    ps = simdMadd(ps, h2, simdSplat( 8.33333333e-3f));     //  1/5!
+    ps = simdMadd(ps, h2, simdSplat(-1.66666667e-1f));     // -1/3!
+    f32x4 sh = simdMadd(simdMul(ps, h2), h, h);
+
+    f32x4 pc = simdSplat(2.08767570e-9f);                  //  1/12!
+    pc = simdMadd(pc, h2, simdSplat(-2.75573192e-7f));     // -1/10!
+    pc = simdMadd(pc, h2, simdSplat( 2.48015873e-5f));     //  1/8!
+    pc = simdMadd(pc, h2, simdSplat(-1.38888889e-3f));     // -1/6!
+    pc = simdMadd(pc, h2, simdSplat( 4.16666667e-2f));     //  1/4!
+    pc = simdMadd(pc, h2, simdSplat(-0.5f));               // -1/2!
+    f32x4 ch = simdMadd(pc, h2, simdSplat(1.0f));
+
+    s = simdMul(simdSplat(2.0f), simdMul(sh, ch));
+    c = simdSub(simdSplat(1.0f), simdMul(simdSplat(2.0f), simdMul(sh, sh)));
+}
@@ -0,0 +1,141 @@
+#pragma once
+// Streaming ring buffer for per-frame dynamic data (GL 3.3).
+//
+// Each frame suballocates from one large buffer object. Ranges are mapped with
+// GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT, so the driver never
+// waits on (or copies around) draws still reading older parts of the buffer.
+// Instead endFrame() drops a fence after the frame's draws, and an allocation
+// that is about to wrap onto a region the GPU may still be reading waits on that
+// region's fence first. With a ring of about three frames that wait is normally
+// already signalled.
+//
+// Mapping goes through GL_COPY_WRITE_BUFFER, so allocating never disturbs the
+// caller's GL_ARRAY_BUFFER / GL_UNIFORM_BUFFER bindings.
+//
+// A fence only covers the commands of the context it was created in. When other
+// contexts in the share group read a frame's data, each calls fenceReader() after
+// its last such draw, and the region is only reused once all of them signalled.
+
+#include <glad/glad.h>
+#include <deque>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+class StreamBuffer {
+public:
+    struct Allocation {
+        void* ptr = nullptr;     // write-only, valid until unmap()
+        GLintptr offset = 0;     // byte offset of ptr within buffer()
+        GLsizeiptr size = 0;
+    };
+
+    void create(GLsizeiptr bytes) {
+        capacity = bytes;
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    }
+
+    void destroy() {
+        for (Region& r : inFlight)
+            for (GLsync f : r.fences) glDeleteSync(f);
+        for (GLsync f : readerFences) glDeleteSync(f);
+        inFlight.clear();
+        readerFences.clear();
+        if (id) glDeleteBuffers(1, &id);
+        id = 0;
+    }
+
+    GLuint buffer() const { return id; }
+    GLsizeiptr size() const { return capacity; }
+    // number of times an allocation had to block on the GPU
+    unsigned long stalls() const { return stallCount; }
+
+    // Maps bytes at the given alignment (a power of two, e.g. the UBO offset
+    // alignment). Returns a null ptr if a single frame asks for more than the ring.
+    Allocation map(GLsizeiptr bytes, GLsizeiptr align = 16) {
+        Allocation a;
+        GLintptr offset = (head + align - 1) & ~GLintptr(align - 1);
+        GLsizeiptr consumed = (offset - head) + bytes;
+        if (offset + bytes > capacity) {
+            consumed = (capacity - head) + bytes;   // the skipped tail still belongs to this frame
+            offset = 0;
+        }
+        if (frameUsed + consumed >= capacity) {
+            std::cerr << "StreamBuffer: frame needs more than " << capacity << " bytes" << std::endl;
+            return a;
+        }
+        frameUsed += consumed;
+        waitFor(offset, offset + bytes);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        a.ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                 GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!a.ptr) return a;
+        a.offset = offset;
+        a.size = bytes;
+        head = offset + bytes;
+        return a;
+    }
+
+    // Flushes everything written through a.ptr and releases the mapping.
+    void unmap(const Allocation& a) {
+        if (!a.ptr) return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, a.size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+
+    // Call in any other context that read this frame's allocations, after its
+    // last draw that does.
+    void fenceReader() {
+        if (frameUsed > 0) readerFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    }
+
+    // Call after the last draw that reads this frame's allocations.
+    void endFrame() {
+        if (frameUsed > 0) {
+            readerFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            inFlight.push_back({ std::move(readerFences), frameStart, head });
+        }
+        readerFences.clear();
+        frameStart = head;
+        frameUsed = 0;
+    }
+
+private:
+    // [begin, end) in ring order; end < begin means the frame wrapped around
+    struct Region { std::vector<GLsync> fences; GLintptr begin, end; };
+
+    static bool overlaps(const Region& r, GLintptr a, GLintptr b) {
+        if (r.begin <= r.end) return a < r.end && r.begin < b;
+        return a < r.end || b > r.begin;
+    }
+
+    // Regions sit in the ring in submission order, so the oldest one is always
+    // the next to be overwritten: retire from the front until [a, b) is free.
+    void waitFor(GLintptr a, GLintptr b) {
+        while (!inFlight.empty() && overlaps(inFlight.front(), a, b)) {
+            for (GLsync fence : inFlight.front().fences) {
+                GLenum r = glClientWaitSync(fence, 0, 0);
+                if (r == GL_TIMEOUT_EXPIRED) {
+                    stallCount++;
+                    do r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                    while (r == GL_TIMEOUT_EXPIRED);
+                }
+                glDeleteSync(fence);
+            }
+            inFlight.pop_front();
+        }
+    }
+
+    GLuint id = 0;
+    GLsizeiptr capacity = 0;
+    GLintptr head = 0, frameStart = 0;
+    GLsizeiptr frameUsed = 0;
+    unsigned long stallCount = 0;
+    std::vector<GLsync> readerFences;
+    std::deque<Region> inFlight;
+};
@@ -0,0 +1,35 @@
+#pragma once
+// Scale / rotate / translate transform composed in closed form, using the
+// mat4.h layout (row vectors, translation in the last row).
+
+#include "quat.h"
+#include <cmath>
+
+// m = S(s) * Rx(rx) * Ry(ry) * T(tx,ty,tz) without any general 4x4 multiplies:
+// one cos/sin pair per axis and the product written out element by element.
+inline void composeTRS(float* m, float s, float rx, float ry, float tx, float ty, float tz) {
+    float cx = std::cos(rx), sx = std::sin(rx);
+    float cy = std::cos(ry), sy = std::sin(ry);
+    m[0]  = s*cy;     m[1]  = 0.0f;   m[2]  = -s*sy;    m[3]  = 0.0f;
+    m[4]  = s*sx*sy;  m[5]  = s*cx;   m[6]  = s*sx*cy;  m[7]  = 0.0f;
+    m[8]  = s*cx*sy;  m[9]  = -s*sx;  m[10] = s*cx*cy;  m[11] = 0.0f;
+    m[12] = tx;       m[13] = ty;     m[14] = tz;       m[15] = 1.0f;
+}
+
+// Transform parameters plus the cached matrix. Whoever edits a parameter sets
+// dirty; update() only recomposes (and asks for a re-upload) after that.
+struct Transform {
+    float scale = 1.0f;
+    Quat orientation;
+    float transX = 0.0f, transY = 0.0f, transZ = 0.0f;
+    bool dirty = true;
+    float matrix[16];
+
+    // Returns true when matrix changed since the previous call.
+    bool update() {
+        if (!dirty) return false;
+        composeQuatTRS(matrix, scale, orientation, transX, transY, transZ);
+        dirty = false;
+        return true;
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+// Structure-of-arrays transform engine: N objects' scale / rotation / translation
+// in parallel arrays, composed into N model matrices (mat4.h layout, 16 floats
+// each) four objects at a time.
+
+#include "simd.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TransformBatch {
+    std::vector<float> scale, rotX, rotY, transX, transY, transZ;
+
+    std::size_t size() const { return scale.size(); }
+
+    void resize(std::size_t n) {
+        scale.resize(n, 1.0f);
+        rotX.resize(n, 0.0f); rotY.resize(n, 0.0f);
+        transX.resize(n, 0.0f); transY.resize(n, 0.0f); transZ.resize(n, 0.0f);
+    }
+
+    // Writes size() matrices to out, which may be a mapped instance buffer.
+    // Matches composeTRS() in transform.h to within the simdSinCos error.
+    void compose(float* out) const { compose(out, 0, size()); }
+
+    // Same, for objects [first, first+count) only; out receives count matrices.
+    // A 16-byte aligned out is written with non-temporal stores: the matrices
+    // are headed for the GPU, and skipping the cache roughly halves the cost
+    // once the output outgrows it.
+    void compose(float* out, std::size_t first, std::size_t count) const {
+        std::size_t i = first, end = first + count;
+        bool stream = (reinterpret_cast<std::uintptr_t>(out) & 15) == 0;
+        for (; i + 4 <= end; i += 4, out += 64)
+            composeBlock(out, 4, stream, &scale[i], &rotX[i], &rotY[i], &transX[i], &transY[i], &transZ[i]);
+        if (i < end) {
+            // pad the tail to a full block so every object goes through the same math
+            float pad[6][4] = {};
+            std::size_t n = end - i;
+            for (std::size_t k=0; k<n; k++) {
+                pad[0][k]=scale[i+k];  pad[1][k]=rotX[i+k];   pad[2][k]=rotY[i+k];
+                pad[3][k]=transX[i+k]; pad[4][k]=transY[i+k]; pad[5][k]=transZ[i+k];
+            }
+            composeBlock(out, n, false, pad[0], pad[1], pad[2], pad[3], pad[4], pad[5]);
+        }
+        if (stream) simdStreamFence();
+    }
+
+private:
+    static void composeBlock(float* out, std::size_t n, bool stream, const float* s, const float* rx, const float* ry,
+                             const float* tx, const float* ty, const float* tz) {
+        f32x4 vs = simdLoad(s), cx, sx, cy, sy;
+        simdSinCos(simdLoad(rx), sx, cx);
+        simdSinCos(simdLoad(ry), sy, cy);
+        f32x4 zero = simdSplat(0.0f), one = simdSplat(1.0f);
+        f32x4 ssx = simdMul(vs, sx), scx = simdMul(vs, cx);
+
+        // one register per matrix element across the four objects, then a 4x4
+        // transpose per row turns them into each object's row
+        f32x4 rows[4][4] = {
+            { simdMul(vs, cy),  zero,                 simdSub(zero, simdMul(vs, sy)), zero },
+            { simdMul(ssx, sy), scx,                  simdMul(ssx, cy),               zero },
+            { simdMul(scx, sy), simdSub(zero, ssx),   simdMul(scx, cy),               zero },
+            { simdLoad(tx),     simdLoad(ty),         simdLoad(tz),                   one  },
+        };
+        for (int r=0; r<4; r++) {
+            f32x4 a = rows[r][0], b = rows[r][1], c = rows[r][2], d = rows[r][3];
+            simdTranspose(a, b, c, d);
+            if (n == 4 && stream) {
+                simdStoreStream(out + r*4, a);      simdStoreStream(out + 16 + r*4, b);
+                simdStoreStream(out + 32 + r*4, c); simdStoreStream(out + 48 + r*4, d);
+            } else if (n == 4) {
+                simdStore(out + r*4, a);      simdStore(out + 16 + r*4, b);
+                simdStore(out + 32 + r*4, c); simdStore(out + 48 + r*4, d);
+            } else {
+                f32x4 obj[4] = { a, b, c, d };
+                for (std::size_t k=0; k<n; k++) simdStore(out + k*16 + r*4, obj[k]);
+            }
+        }
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+// Shadow copy of a program's uniform values, so uploads that would not change
+// anything are skipped.
+//
+// The owner (ShaderProgram) registers each active uniform with track() right
+// after linking, when every uniform is zero by definition, so the shadow starts
+// out exact. Uniform values belong to the program object, which is shared
+// across a context share group: one cache per program is enough however many
+// windows draw with it. The setters upload to the current program, so the
+// program must be bound (as for glUniform*) and must be the one reflected.
+//
+// Arrays (size > 1) and locations that were never tracked are passed through
+// uncached.
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class UniformCache {
+public:
+    struct Counters { unsigned long hits = 0, misses = 0; };
+
+    void reset() {
+        slots.clear();
+        values.clear();
+    }
+
+    // Registers the uniform at loc, as reported by glGetActiveUniform.
+    void track(GLint loc, GLenum type, GLint size) {
+        int n = components(type);
+        if (loc < 0 || size != 1 || n == 0) return;
+        if (loc >= GLint(slots.size())) slots.resize(loc + 1);
+        slots[loc] = { int(values.size()), n };
+        values.resize(values.size() + n, 0u);
+    }
+
+    const Counters& counters() const { return count; }
+
+    void set1f(GLint loc, float x) { float v[1] = { x }; if (changed(loc, v, 1)) glUniform1f(loc, x); }
+    void set2f(GLint loc, float x, float y) { float v[2] = { x, y }; if (changed(loc, v, 2)) glUniform2f(loc, x, y); }
+    void set3f(GLint loc, float x, float y, float z) {
+        float v[3] = { x, y, z };
+        if (changed(loc, v, 3)) glUniform3f(loc, x, y, z);
+    }
+    void set3fv(GLint loc, const float* v) { if (changed(loc, v, 3)) glUniform3fv(loc, 1, v); }
+    void set1i(GLint loc, GLint x) { GLint v[1] = { x }; if (changed(loc, v, 1)) glUniform1i(loc, x); }
+    void setMatrix4fv(GLint loc, const float* m) { if (changed(loc, m, 16)) glUniformMatrix4fv(loc, 1, GL_FALSE, m); }
+
+private:
+    struct Slot { int offset = -1, components = 0; };
+
+    // 32-bit components per value; 0 for types the cache does not shadow
+    static int components(GLenum type) {
+        switch (type) {
+            case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL:
+            case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+                return 1;
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: return 2;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: return 3;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_FLOAT_MAT2: return 4;
+            case GL_FLOAT_MAT3: return 9;
+            case GL_FLOAT_MAT4: return 16;
+            default: return 0;
+        }
+    }
+
+    // Compares bit patterns, so -0.0f vs 0.0f counts as a change (one extra
+    // upload) and a NaN that is re-sent unchanged is still recognised.
+    bool changed(GLint loc, const void* v, int n) {
+        if (loc < 0) return false;   // glUniform* ignores -1 too
+        if (loc >= GLint(slots.size()) || slots[loc].components != n) { count.misses++; return true; }
+        std::uint32_t* shadow = &values[slots[loc].offset];
+        std::size_t bytes = std::size_t(n) * sizeof(std::uint32_t);
+        if (std::memcmp(shadow, v, bytes) == 0) { count.hits++; return false; }
+        std::memcpy(shadow, v, bytes);
+        count.misses++;
+        return true;
+    }
+
+    std::vector<Slot> slots;            // indexed by location
+    std::vector<std::uint32_t> values;
+    Counters count;
+};
@@ -0,0 +1,223 @@
+#pragma once
+// Fixed-size matrix / vector types whose structure is known at compile time.
+//
+// Every matrix expression reports, per element, whether it is a structural zero,
+// a structural one or an arbitrary value. Products are expression templates that
+// skip zero terms and unit factors while the chain is being instantiated, so
+// S * Rx * Ry * T collapses to the same handful of multiplies as the hand
+// written closed form instead of four general 4x4 products, and nothing is
+// materialized until the result is stored in a Mat.
+//
+// Layout matches mat4.h: row vectors, element (i,j) stored at m[i*C+j], uploaded
+// with transpose = GL_FALSE.
+
+#include <cstddef>
+#include <utility>
+
+enum class Elem { Zero, One, Any };
+
+// ----------------- constexpr trig -----------------
+struct SinCos { float s, c; };
+
+// Same scheme as simdSinCos: wrap to [-pi, pi], Taylor on the half angle,
+// double-angle back. Usable in constant expressions and at runtime.
+constexpr SinCos cxSinCos(float x) {
+    double turns = double(x) * 0.15915494309189535;
+    long long k = (long long)(turns < 0 ? turns - 0.5 : turns + 0.5);
+    double h = 0.5 * (double(x) - double(k) * 6.283185307179586);
+    double h2 = h*h;
+    double sh = h * (1 + h2*(-1.0/6 + h2*(1.0/120 + h2*(-1.0/5040 + h2*(1.0/362880 + h2*(-1.0/39916800))))));
+    double ch = 1 + h2*(-0.5 + h2*(1.0/24 + h2*(-1.0/720 + h2*(1.0/40320 + h2*(-1.0/3628800 + h2*(1.0/479001600))))));
+    return { float(2*sh*ch), float(1 - 2*sh*sh) };
+}
+constexpr float cxTan(float x) { SinCos sc = cxSinCos(x); return sc.s / sc.c; }
+constexpr float cxRadians(float deg) { return deg * 0.017453292519943295f; }
+
+// ----------------- expression base -----------------
+template <class E> struct MatExpr {
+    constexpr const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <int R, int C>
+struct Mat : MatExpr<Mat<R,C>> {
+    static constexpr int rows = R, cols = C;
+    float m[R*C];
+
+    constexpr Mat() : m{} {}
+    constexpr explicit Mat(const float (&a)[R*C]) : Mat(a, std::make_index_sequence<R*C>()) {}
+    template <class E>
+    constexpr Mat(const MatExpr<E>& e) : Mat(e.self(), std::make_index_sequence<R*C>()) {
+        static_assert(E::rows == R && E::cols == C, "matrix size mismatch");
+    }
+
+    template <int I, int J> static constexpr Elem kind() { return Elem::Any; }
+    template <int I, int J> constexpr float get() const { return m[I*C+J]; }
+    constexpr float operator()(int i, int j) const { return m[i*C+j]; }
+    const float* data() const { return m; }
+
+private:
+    template <std::size_t... Idx>
+    constexpr Mat(const float (&a)[R*C], std::index_sequence<Idx...>) : m{ a[Idx]... } {}
+    template <class E, std::size_t... Idx>
+    constexpr Mat(const E& e, std::index_sequence<Idx...>) : m{ e.template get<int(Idx)/C, int(Idx)%C>()... } {}
+};
+typedef Mat<4,4> Mat4;
+
+template <int N>
+struct Vec {
+    float v[N];
+    constexpr float operator[](int i) const { return v[i]; }
+    const float* data() const { return v; }
+};
+typedef Vec<3> Vec3;
+typedef Vec<4> Vec4;
+
+// ----------------- structured 4x4 matrices -----------------
+template <int N>
+struct Identity : MatExpr<Identity<N>> {
+    static constexpr int rows = N, cols = N;
+    template <int I, int J> static constexpr Elem kind() { return I == J ? Elem::One : Elem::Zero; }
+    template <int I, int J> constexpr float get() const { return I == J ? 1.0f : 0.0f; }
+};
+
+struct Scale : MatExpr<Scale> {
+    static constexpr int rows = 4, cols = 4;
+    float x, y, z;
+    constexpr explicit Scale(float s) : x(s), y(s), z(s) {}
+    constexpr Scale(float x, float y, float z) : x(x), y(y), z(z) {}
+    template <int I, int J> static constexpr Elem kind() {
+        return I != J ? Elem::Zero : I == 3 ? Elem::One : Elem::Any;
+    }
+    template <int I, int J> constexpr float get() const {
+        return I != J ? 0.0f : I == 0 ? x : I == 1 ? y : I == 2 ? z : 1.0f;
+    }
+};
+
+struct Translate : MatExpr<Translate> {
+    static constexpr int rows = 4, cols = 4;
+    float x, y, z;
+    constexpr Translate(float x, float y, float z) : x(x), y(y), z(z) {}
+    template <int I, int J> static constexpr Elem kind() {
+        return I == J ? Elem::One : (I == 3 && J < 3) ? Elem::Any : Elem::Zero;
+    }
+    template <int I, int J> constexpr float get() const {
+        return I == J ? 1.0f : I != 3 || J == 3 ? 0.0f : J == 0 ? x : J == 1 ? y : z;
+    }
+};
+
+// Rotation about a coordinate axis, in the same sign convention as cube.cpp's
+// original Rx / Ry matrices. A and B are the two rows/columns the rotation mixes.
+template <int A, int B>
+struct AxisRotation : MatExpr<AxisRotation<A,B>> {
+    static constexpr int rows = 4, cols = 4;
+    float c, s;
+    constexpr explicit AxisRotation(float angle) : AxisRotation(cxSinCos(angle)) {}
+    constexpr explicit AxisRotation(SinCos sc) : c(sc.c), s(sc.s) {}
+    template <int I, int J> static constexpr Elem kind() {
+        return (I == A || I == B) && (J == A || J == B) ? Elem::Any : I == J ? Elem::One : Elem::Zero;
+    }
+    template <int I, int J> constexpr float get() const {
+        return (I == A || I == B) && (J == A || J == B) ? (I == J ? c : I == A ? s : -s)
+             : I == J ? 1.0f : 0.0f;
+    }
+};
+typedef AxisRotation<1,2> RotX;   // rows 1,2: (0, c, s) / (0, -s, c)
+typedef AxisRotation<2,0> RotY;   // rows 0,2: (c, 0, -s) / (s, 0, c)
+typedef AxisRotation<0,1> RotZ;
+
+// Perspective with the far plane at infinity, as cube.cpp uses:
+// x' = f/aspect x, y' = f y, z' = -z - 2 near, w' = -z.
+struct InfinitePerspective : MatExpr<InfinitePerspective> {
+    static constexpr int rows = 4, cols = 4;
+    float fx, fy, zw;
+    constexpr InfinitePerspective(float fovyRadians, float aspect, float near)
+        : fx(1.0f / cxTan(0.5f * fovyRadians) / aspect), fy(1.0f / cxTan(0.5f * fovyRadians)), zw(-2.0f * near) {}
+    template <int I, int J> static constexpr Elem kind() {
+        return (I == J && I < 2) || (I == 3 && J == 2) ? Elem::Any
+             : (I == 2 && J >= 2) ? Elem::Any : Elem::Zero;
+    }
+    template <int I, int J> constexpr float get() const {
+        return I == 0 && J == 0 ? fx : I == 1 && J == 1 ? fy : I == 3 && J == 2 ? zw
+             : I == 2 && J >= 2 ? -1.0f : 0.0f;
+    }
+};
+
+// ----------------- products -----------------
+template <class L, class R>
+struct Product : MatExpr<Product<L,R>> {
+    static_assert(L::cols == R::rows, "matrix size mismatch");
+    static constexpr int rows = L::rows, cols = R::cols;
+    L l; R r;
+    constexpr Product(const L& l, const R& r) : l(l), r(r) {}
+
+    template <int I, int J, int K>
+    static constexpr bool term() { return L::template kind<I,K>() != Elem::Zero && R::template kind<K,J>() != Elem::Zero; }
+
+    template <int I, int J> static constexpr Elem kind() { return kindOf<I,J>(std::make_index_sequence<L::cols>()); }
+
+    template <int I, int J> constexpr float get() const {
+        if constexpr (kind<I,J>() == Elem::Zero) return 0.0f;
+        else if constexpr (kind<I,J>() == Elem::One) return 1.0f;
+        else return sum<I,J,0,false>(0.0f);
+    }
+
+private:
+    template <int I, int J, std::size_t... K>
+    static constexpr Elem kindOf(std::index_sequence<K...>) {
+        int terms = (0 + ... + (term<I,J,int(K)>() ? 1 : 0));
+        bool unit = (false || ... || (term<I,J,int(K)>() && L::template kind<I,int(K)>() == Elem::One
+                                                        && R::template kind<int(K),J>() == Elem::One));
+        return terms == 0 ? Elem::Zero : terms == 1 && unit ? Elem::One : Elem::Any;
+    }
+
+    template <int I, int J, int K>
+    constexpr float factor() const {
+        if constexpr (L::template kind<I,K>() == Elem::One) return r.template get<K,J>();
+        else if constexpr (R::template kind<K,J>() == Elem::One) return l.template get<I,K>();
+        else return l.template get<I,K>() * r.template get<K,J>();
+    }
+
+    // accumulate only the live terms so no "+ 0" or "* 1" ever reaches codegen
+    template <int I, int J, int K, bool Started>
+    constexpr float sum(float acc) const {
+        if constexpr (K == L::cols) return acc;
+        else if constexpr (!term<I,J,K>()) return sum<I,J,K+1,Started>(acc);
+        else if constexpr (Started) return sum<I,J,K+1,true>(acc + factor<I,J,K>());
+        else return sum<I,J,K+1,true>(factor<I,J,K>());
+    }
+};
+
+template <class L, class R>
+constexpr Product<L,R> operator*(const MatExpr<L>& l, const MatExpr<R>& r) { return Product<L,R>(l.self(), r.self()); }
+
+// Writes an expression straight into a flat array (e.g. a mapped buffer or a
+// Transform::matrix) without going through a Mat temporary.
+template <class E, std::size_t... Idx>
+inline void storeMatrix(float* out, const E& e, std::index_sequence<Idx...>) {
+    ((out[Idx] = e.template get<int(Idx)/E::cols, int(Idx)%E::cols>()), ...);
+}
+template <class E>
+inline void storeMatrix(float* out, const MatExpr<E>& e) {
+    storeMatrix(out, e.self(), std::make_index_sequence<E::rows*E::cols>());
+}
+
+// row vector * matrix, skipping structural zeros the same way Product does
+template <int J, int K, bool Started, class E, int N>
+constexpr float rowDot(const Vec<N>& v, const E& e, float acc) {
+    if constexpr (K == N) return Started ? acc : 0.0f;
+    else if constexpr (E::template kind<K,J>() == Elem::Zero) return rowDot<J,K+1,Started>(v, e, acc);
+    else {
+        float t = v[K];
+        if constexpr (E::template kind<K,J>() != Elem::One) t *= e.template get<K,J>();
+        if constexpr (Started) return rowDot<J,K+1,true>(v, e, acc + t);
+        else return rowDot<J,K+1,true>(v, e, t);
+    }
+}
+template <class E, std::size_t... J>
+constexpr Vec<E::cols> transformRow(const Vec<E::rows>& v, const E& e, std::index_sequence<J...>) {
+    return { { rowDot<int(J),0,false>(v, e, 0.0f)... } };
+}
+template <class E>
+constexpr Vec<E::cols> operator*(const Vec<E::rows>& v, const MatExpr<E>& e) {
+    return transformRow(v, e.self(), std::make_index_sequence<E::cols>());
+}